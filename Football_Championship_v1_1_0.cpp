@@ -1,5 +1,6 @@
 #include <iostream>
 #include <vector>
+#include <deque>
 #include <string>
 #include <algorithm>
 #include <fstream>
@@ -9,11 +10,86 @@
 #include <ctime>
 #include <random>
 #include <map>
+#include <unordered_map>
 #include <cctype>
 #include <limits>
+#include <thread>
+#include <mutex>
+#include <numeric>
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <array>
+#include <memory>
+#include <filesystem>
+#include <charconv>
+#include <csignal>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
+// Heap allocation counter reported by the benchmark suite. Replacing the
+// global operator new costs an atomic increment on every allocation, so it is
+// only compiled in with -DFC_COUNT_ALLOCS; otherwise allocations are not counted.
+// The replacements are kept out of line so GCC does not pair the inlined
+// malloc/free with new/delete expressions (-Wmismatched-new-delete).
+#if defined(__GNUC__)
+#define FCM_NOINLINE __attribute__((noinline))
+#else
+#define FCM_NOINLINE
+#endif
+
+#ifdef FC_COUNT_ALLOCS
+atomic<uint64_t> heapAllocations(0);
+
+FCM_NOINLINE void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    if (void* memory = malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw bad_alloc();
+}
+
+FCM_NOINLINE void* operator new(size_t size, const nothrow_t&) noexcept {
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+FCM_NOINLINE void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+FCM_NOINLINE void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+FCM_NOINLINE void operator delete(void* memory, const nothrow_t&) noexcept {
+    free(memory);
+}
+#endif
+
 // Helper function to truncate long strings
 static string truncateString(const string& str, size_t width) {
     if (str.length() > width) {
@@ -22,9 +98,67 @@ static string truncateString(const string& str, size_t width) {
     return str;
 }
 
+// Stream buffer that discards everything (silences progress messages)
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// Copy-on-write value: copies share one T until one of them calls mut(),
+// which gives that copy its own T first. Reads forward to the shared value,
+// so containers keep their const interface (size, [], iteration, find).
+// Default-constructed values share a single empty T.
+template <typename T>
+class Cow {
+private:
+    shared_ptr<T> value;
+
+    static const shared_ptr<T>& emptyValue() {
+        static const shared_ptr<T> empty = make_shared<T>();
+        return empty;
+    }
+
+public:
+    Cow() : value(emptyValue()) {}
+    Cow(T initial) : value(make_shared<T>(move(initial))) {}
+
+    const T& operator*() const { return *value; }
+    const T* operator->() const { return value.get(); }
+
+    // Writable access, unsharing the value first. A value that is no longer
+    // shared may have been released by another thread (query server
+    // snapshots), so its reads are ordered before our writes.
+    T& mut() {
+        if (value.use_count() > 1) {
+            value = make_shared<T>(*value);
+        } else {
+            atomic_thread_fence(memory_order_acquire);
+        }
+        return *value;
+    }
+
+    bool sharesWith(const Cow& other) const { return value == other.value; }
+    bool unique() const {
+        if (value.use_count() != 1) return false;
+        atomic_thread_fence(memory_order_acquire);
+        return true;
+    }
+
+    size_t size() const { return value->size(); }
+    bool empty() const { return value->empty(); }
+    auto begin() const { return value->cbegin(); }
+    auto end() const { return value->cend(); }
+    template <typename K>
+    auto operator[](const K& key) const -> decltype((*value)[key]) { return (*value)[key]; }
+    template <typename K>
+    auto find(const K& key) const { return value->find(key); }
+};
+
 // Team class representing a football team
 class Team {
 public:
+    int id;  // Interned ID assigned by the owning championship (-1 until added)
     string name;
     double value;
     int wins;
@@ -34,7 +168,7 @@ public:
     int goalsAgainst;
 
     Team(string name = "", double value = 0.0)
-        : name(name), value(value), wins(0), draws(0), losses(0), 
+        : id(-1), name(name), value(value), wins(0), draws(0), losses(0), 
           goalsFor(0), goalsAgainst(0) {}
 
     // Calculate total points (3 for win, 1 for draw)
@@ -62,680 +196,6725 @@ public:
     }
 };
 
-// Match structure to store fixture information
+// Counter-based random number service for match simulation.
+// Every draw is a pure function of (seed, season, stage, match, lane), so any
+// match can be replayed bit-for-bit without touching shared engine state and
+// parallel workers never need to coordinate. Season 0 is the live season;
+// simulated seasons use 1, 2, ... Playing a live stage again uses the next
+// attempt, so it draws new scores.
+class MatchRng {
+public:
+    // SplitMix64 finalizer
+    static uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    // Key of an independent stream for one attempt at one stage of one season
+    static uint64_t streamKey(uint64_t seed, uint64_t season, uint64_t stage, uint64_t attempt = 0) {
+        uint64_t key = mix(mix(mix(seed) ^ season) ^ stage);
+        return attempt == 0 ? key : mix(key ^ mix(attempt));
+    }
+
+    // Uniform double in [0, 1) for a given match and lane of a stream
+    static double uniform(uint64_t key, uint64_t match, uint64_t lane) {
+        uint64_t bits = mix(key ^ mix((match << 1) | (lane & 1)));
+        return (bits >> 11) * (1.0 / 9007199254740992.0);  // 53-bit mantissa
+    }
+
+    // Fresh non-deterministic seed for new championships
+    static uint64_t randomSeed() {
+        random_device rd;
+        return (static_cast<uint64_t>(rd()) << 32) ^ rd();
+    }
+};
+
+// Match simulation model: goals are Poisson with mean strength / 50, where
+// the home side's strength is its value times the home advantage, capped at 5
+const double HOME_ADVANTAGE = 1.2;
+const double GOAL_RATE_DIVISOR = 50.0;
+const int MAX_GOALS = 5;
+
+// Fixtures of one stage laid out as arrays for batched simulation. The
+// per-match Poisson rates are fixed when the batch is built, so Monte Carlo
+// workers can share one batch and only redraw the uniforms.
+struct StageBatch {
+    vector<int32_t> home;        // Team indices
+    vector<int32_t> away;
+    vector<int32_t> slot;        // Position in the stage (selects the RNG draw)
+    vector<double> homeRate;     // Poisson means
+    vector<double> awayRate;
+    vector<double> homeStart;    // exp(-rate): P(0 goals)
+    vector<double> awayStart;
+
+    size_t size() const { return home.size(); }
+
+    void clear() {
+        home.clear();
+        away.clear();
+        slot.clear();
+        homeRate.clear();
+        awayRate.clear();
+        homeStart.clear();
+        awayStart.clear();
+    }
+
+    void add(int homeIndex, int awayIndex, int matchSlot, double homeValue, double awayValue) {
+        double hr = homeValue * HOME_ADVANTAGE / GOAL_RATE_DIVISOR;
+        double ar = awayValue / GOAL_RATE_DIVISOR;
+        home.push_back(homeIndex);
+        away.push_back(awayIndex);
+        slot.push_back(matchSlot);
+        homeRate.push_back(hr);
+        awayRate.push_back(ar);
+        homeStart.push_back(exp(-hr));
+        awayStart.push_back(exp(-ar));
+    }
+};
+
+// Per-thread scratch space and kernel that samples every score of a stage
+struct StageSample {
+    vector<double> homeUniform;
+    vector<double> awayUniform;
+    vector<double> probability;
+    vector<double> cumulative;
+    vector<int32_t> homeGoals;
+    vector<int32_t> awayGoals;
+
+    // Inverse-CDF sampling capped at MAX_GOALS: goals = #{k < MAX_GOALS : u >= F(k)}.
+    // Loops run over the whole stage per k, so they are branch-free and vectorizable.
+    void sampleCapped(const double* rate, const double* start, const double* u,
+                      int32_t* goals, size_t n) {
+        probability.assign(start, start + n);
+        cumulative.assign(start, start + n);
+        fill(goals, goals + n, 0);
+        for (int k = 1; k <= MAX_GOALS; k++) {
+            double* p = probability.data();
+            double* cdf = cumulative.data();
+            for (size_t i = 0; i < n; i++) {
+                goals[i] += u[i] >= cdf[i];
+                p[i] *= rate[i] / k;
+                cdf[i] += p[i];
+            }
+        }
+    }
+
+    // Draw uniforms from the stage stream and sample both sides of every match
+    void run(const StageBatch& batch, uint64_t streamKey) {
+        size_t n = batch.size();
+        homeUniform.resize(n);
+        awayUniform.resize(n);
+        homeGoals.resize(n);
+        awayGoals.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            homeUniform[i] = MatchRng::uniform(streamKey, batch.slot[i], 0);
+            awayUniform[i] = MatchRng::uniform(streamKey, batch.slot[i], 1);
+        }
+        sampleCapped(batch.homeRate.data(), batch.homeStart.data(), homeUniform.data(), homeGoals.data(), n);
+        sampleCapped(batch.awayRate.data(), batch.awayStart.data(), awayUniform.data(), awayGoals.data(), n);
+    }
+};
+
+// Match structure to store fixture information (teams by interned ID)
 struct Match {
-    string homeTeam;
-    string awayTeam;
+    int homeId;
+    int awayId;
     int homeGoals;
     int awayGoals;
     bool played;
 
-    Match(string home, string away) 
-        : homeTeam(home), awayTeam(away), homeGoals(0), awayGoals(0), played(false) {}
+    Match(int home, int away) 
+        : homeId(home), awayId(away), homeGoals(0), awayGoals(0), played(false) {}
 };
 
-// Championship class managing the entire league
-class Championship {
+// Stored outcome of one fixture
+struct MatchResult {
+    uint8_t homeGoals;
+    uint8_t awayGoals;
+    uint8_t played;
+
+    bool operator==(const MatchResult& other) const {
+        return homeGoals == other.homeGoals && awayGoals == other.awayGoals && played == other.played;
+    }
+
+    // Whether a score read from a file fits the stored counters
+    static bool fits(int homeGoals, int awayGoals) {
+        return homeGoals >= 0 && homeGoals <= UINT8_MAX && awayGoals >= 0 && awayGoals <= UINT8_MAX;
+    }
+};
+
+// Double round-robin schedule. Generated schedules keep only the roster and
+// compute the (home, away) pair of any (stage, slot) in O(1) from the circle
+// method; results are stored per stage, allocated when a stage is first
+// played. Fixture lists loaded from files that do not follow the formula
+// are kept as explicit pairs instead. Copies share the roster, the pairs and
+// every stage's results until they are changed.
+class FixtureSchedule {
+public:
+    static constexpr int BYE = -1;  // Dummy team for bye weeks
+
 private:
-    string name;
-    vector<Team> teams;
-    vector<vector<Match>> fixtures;
-    int stagesCompleted;
-    int totalStages;
+    Cow<vector<int32_t>> roster;                         // Team IDs padded to even size (formula mode)
+    Cow<vector<vector<pair<int32_t, int32_t>>>> pairs;   // Per-stage (home, away) IDs (explicit mode)
+    vector<Cow<vector<MatchResult>>> results;            // Per stage; empty until a result is stored
+    int stages;
 
-    // Helper function to find team index
-    int findTeamIndex(const string& teamName) {
-        for (size_t i = 0; i < teams.size(); i++) {
-            if (teams[i].name == teamName) {
-                return i;
-            }
-        }
-        return -1;
+    int rosterSize() const { return roster.size(); }
+
+    // Team at a circle position after `round` rotations of positions 1..n-1
+    int atPosition(int position, int round) const {
+        if (position == 0) return roster[0];
+        int cycle = rosterSize() - 1;
+        return roster[1 + ((position - 1 - round) % cycle + cycle) % cycle];
+    }
+
+    // Pair index of a slot: slots skip the pair holding the BYE team
+    int pairIndex(int stage, int slot) const {
+        int n = rosterSize();
+        if (roster[n - 1] != BYE) return slot;
+        int cycle = n - 1;
+        int byePosition = 1 + (n - 2 + stage) % cycle;
+        int byePair = min(byePosition, n - 1 - byePosition);
+        return slot < byePair ? slot : slot + 1;
     }
 
 public:
-    Championship(string name = "") : name(name), stagesCompleted(0), totalStages(0) {}
+    FixtureSchedule() : stages(0) {}
 
-    // Add a new team to the championship
-    void addTeam(const Team& team) {
-        teams.push_back(team);
+    // Build the schedule for teams in the given order
+    void generate(const vector<int>& teamIds) {
+        clear();
+        vector<int32_t>& ids = roster.mut();
+        ids.assign(teamIds.begin(), teamIds.end());
+        if (ids.size() % 2 != 0) {
+            ids.push_back(BYE);
+        }
+        stages = (rosterSize() - 1) * 2;  // Home and away
+        results.assign(stages, Cow<vector<MatchResult>>());
     }
 
-    // Remove a team (relegation)
-    void relegateTeam(const string& teamName) {
-        int index = findTeamIndex(teamName);
-        if (index != -1) {
-            teams.erase(teams.begin() + index);
-            cout << teamName << " relegated successfully.\n";
-        } else {
-            cout << "Team not found!\n";
+    // Adopt an explicit fixture list, switching to formula mode when it
+    // matches the circle method for rosterHint
+    void assign(const vector<vector<Match>>& fixtureList, const vector<int>& rosterHint) {
+        clear();
+        stages = fixtureList.size();
+        if (rosterHint.size() >= 2) {
+            FixtureSchedule candidate;
+            candidate.generate(rosterHint);
+            bool matches = candidate.stages == stages;
+            for (int stage = 0; matches && stage < stages; stage++) {
+                matches = candidate.matchCount(stage) == static_cast<int>(fixtureList[stage].size());
+                for (int slot = 0; matches && slot < candidate.matchCount(stage); slot++) {
+                    pair<int, int> teams = candidate.teamsAt(stage, slot);
+                    matches = teams.first == fixtureList[stage][slot].homeId &&
+                              teams.second == fixtureList[stage][slot].awayId;
+                }
+            }
+            if (matches) {
+                roster = candidate.roster;
+            }
+        }
+        if (roster.empty()) {
+            vector<vector<pair<int32_t, int32_t>>>& stagePairs = pairs.mut();
+            stagePairs.resize(stages);
+            for (int stage = 0; stage < stages; stage++) {
+                for (const Match& match : fixtureList[stage]) {
+                    stagePairs[stage].emplace_back(match.homeId, match.awayId);
+                }
+            }
+        }
+        results.assign(stages, Cow<vector<MatchResult>>());
+        for (int stage = 0; stage < stages; stage++) {
+            for (size_t slot = 0; slot < fixtureList[stage].size(); slot++) {
+                const Match& match = fixtureList[stage][slot];
+                if (match.played || match.homeGoals || match.awayGoals) {
+                    setResult(stage, slot, match.homeGoals, match.awayGoals, match.played);
+                }
+            }
         }
     }
 
-    // Add a new team (promotion)
-    void promoteTeam(const Team& team) {
-        teams.push_back(team);
-        cout << team.name << " promoted successfully.\n";
+    void clear() {
+        roster = Cow<vector<int32_t>>();
+        pairs = Cow<vector<vector<pair<int32_t, int32_t>>>>();
+        results.clear();
+        stages = 0;
     }
 
-    // Generate fixtures using round-robin algorithm
-    void generateFixtures() {
-        fixtures.clear();
-        if (teams.size() < 2) {
-            cout << "Not enough teams to generate fixtures!\n";
-            return;
+    bool empty() const { return stages == 0; }
+    int stageCount() const { return stages; }
+    bool isGenerated() const { return !roster.empty(); }
+    const vector<int32_t>& getRoster() const { return *roster; }
+
+    // Number of real matches (byes excluded) in a stage
+    int matchCount(int stage) const {
+        if (!roster.empty()) {
+            return rosterSize() / 2 - (roster->back() == BYE ? 1 : 0);
         }
+        return pairs[stage].size();
+    }
 
-        // Create a copy of teams and remove dummy if odd number
-        vector<string> teamNames;
-        for (const Team& team : teams) {
-            teamNames.push_back(team.name);
+    // (home, away) team IDs of a fixture
+    pair<int, int> teamsAt(int stage, int slot) const {
+        if (roster.empty()) {
+            return pairs[stage][slot];
         }
-        
-        if (teamNames.size() % 2 != 0) {
-            teamNames.push_back("BYE"); // Dummy team for bye weeks
+        int n = rosterSize();
+        int i = pairIndex(stage, slot);
+        int first = atPosition(i, stage);
+        int second = atPosition(n - 1 - i, stage);
+        return stage % 2 == 0 ? make_pair(first, second) : make_pair(second, first);
+    }
+
+    // Materialized fixture with its result
+    Match at(int stage, int slot) const {
+        pair<int, int> teams = teamsAt(stage, slot);
+        Match match(teams.first, teams.second);
+        if (!results[stage].empty()) {
+            const MatchResult& result = results[stage][slot];
+            match.homeGoals = result.homeGoals;
+            match.awayGoals = result.awayGoals;
+            match.played = result.played != 0;
         }
+        return match;
+    }
 
-        int n = teamNames.size();
-        totalStages = (n - 1) * 2; // Home and away
-        
-        // Generate rounds
-        for (int round = 0; round < totalStages; round++) {
-            vector<Match> roundMatches;
-            for (int i = 0; i < n / 2; i++) {
-                string home = teamNames[i];
-                string away = teamNames[n - 1 - i];
-                
-                // Skip matches with dummy team
-                if (home != "BYE" && away != "BYE") {
-                    if (round % 2 == 0) {
-                        roundMatches.push_back(Match(home, away));
-                    } else {
-                        roundMatches.push_back(Match(away, home));
-                    }
-                }
-            }
-            fixtures.push_back(roundMatches);
-            
-            // Rotate teams
-            rotate(teamNames.begin() + 1, teamNames.begin() + n - 1, teamNames.end());
+    // Whether a stage currently holds played results
+    bool stagePlayed(int stage) const {
+        return !results[stage].empty() && results[stage][0].played;
+    }
+
+    bool hasResults(int stage) const { return !results[stage].empty(); }
+
+    // Whether a stage's stored results are still the buffer of another schedule
+    bool sharesResults(const FixtureSchedule& other, int stage) const {
+        return results[stage].sharesWith(other.results[stage]);
+    }
+
+    // Copy a stage's stored results (empty if it has none), reusing out's buffer
+    void copyResults(int stage, vector<MatchResult>& out) const {
+        out.assign(results[stage].begin(), results[stage].end());
+    }
+
+    // Replace a stage's stored results (empty drops them)
+    void setStageResults(int stage, const vector<MatchResult>& stageResults) {
+        if (stageResults.empty()) {
+            results[stage] = Cow<vector<MatchResult>>();
+        } else {
+            results[stage].mut().assign(stageResults.begin(), stageResults.end());
         }
-        
-        cout << "Generated " << totalStages << " stages with " 
-             << fixtures[0].size() << " matches per stage\n";
     }
 
-    // Display fixtures for a specific stage
-    void displayFixtures(int stage) {
-        if (stage < 0 || stage >= static_cast<int>(fixtures.size())) {
-            cout << "Invalid stage number!\n";
-            return;
+    void setResult(int stage, int slot, int homeGoals, int awayGoals, bool played = true) {
+        vector<MatchResult>& stageResults = results[stage].mut();
+        if (stageResults.empty()) {
+            stageResults.assign(matchCount(stage), MatchResult{0, 0, 0});
         }
+        stageResults[slot] = {static_cast<uint8_t>(homeGoals), static_cast<uint8_t>(awayGoals),
+                                static_cast<uint8_t>(played)};
+    }
 
-        cout << "\n--- " << name << " Stage " << stage + 1 << " Fixtures ---\n";
-        for (const Match& match : fixtures[stage]) {
-            cout << match.homeTeam << " vs " << match.awayTeam;
-            if (match.played) {
-                cout << " : " << match.homeGoals << "-" << match.awayGoals;
-            }
-            cout << endl;
+    // Forget every stored result (fixtures stay)
+    void clearResults() {
+        for (Cow<vector<MatchResult>>& stage : results) {
+            stage = Cow<vector<MatchResult>>();
         }
     }
+};
 
-    // Play a specific stage
-    void playStage(int stage) {
-        if (stage < 0 || stage >= static_cast<int>(fixtures.size())) {
-            cout << "Invalid stage number!\n";
-            return;
+// Effect of playing one stage, kept so it can be undone and redone without
+// re-simulating. Undo subtracts the new results and, if the stage had been
+// played before, adds the old ones back; redo does the opposite.
+struct StageDelta {
+    int stage;
+    int completedBefore;          // stagesCompleted before and after the play
+    int completedAfter;
+    bool replay;                  // Old results were reversed by the play
+    vector<MatchResult> before;   // Stored results before (empty if none)
+    vector<MatchResult> after;
+
+    size_t resultCount() const { return before.size() + after.size(); }
+
+    bool operator==(const StageDelta& other) const {
+        return stage == other.stage && completedBefore == other.completedBefore &&
+               completedAfter == other.completedAfter && replay == other.replay &&
+               before == other.before && after == other.after;
+    }
+};
+
+// Undo history limits per championship; the oldest deltas are dropped first
+const size_t HISTORY_MAX_STAGES = 1024;
+const size_t HISTORY_MAX_RESULTS = 1 << 22;
+
+// Standings history limit: teams x stages (larger leagues keep no history)
+const size_t STANDINGS_HISTORY_MAX_ENTRIES = 1 << 22;
+
+// Standings right after each stage was played: every team's position and
+// points, and its result in that stage packed 4 per byte. Positions, points
+// trajectories and form over a window are read without replaying results.
+// Stages are copy-on-write, so forks share the ones they have in common.
+// Indexed like the teams; a stage that was not played (or whose snapshot is
+// stale) has no record.
+class StandingsHistory {
+public:
+    enum Outcome : uint8_t { NONE, WIN, DRAW, LOSS };
+
+    struct Stage {
+        vector<uint16_t> position;   // Team index -> position (1-based)
+        vector<int32_t> points;
+        vector<uint8_t> outcomes;    // 2 bits per team
+
+        bool empty() const { return position.empty(); }
+        void clear() {
+            position.clear();
+            points.clear();
+            outcomes.clear();
         }
+    };
 
-        // Reset if already played
-        if (fixtures[stage][0].played) {
-            for (Match& match : fixtures[stage]) {
-                // Find teams and reverse previous result
-                int homeIndex = findTeamIndex(match.homeTeam);
-                int awayIndex = findTeamIndex(match.awayTeam);
-                
-                if (homeIndex != -1 && awayIndex != -1) {
-                    Team& home = teams[homeIndex];
-                    Team& away = teams[awayIndex];
-                    
-                    // Reverse previous stats
-                    home.goalsFor -= match.homeGoals;
-                    home.goalsAgainst -= match.awayGoals;
-                    away.goalsFor -= match.awayGoals;
-                    away.goalsAgainst -= match.homeGoals;
-                    
-                    if (match.homeGoals > match.awayGoals) {
-                        home.wins--;
-                        away.losses--;
-                    } else if (match.homeGoals < match.awayGoals) {
-                        home.losses--;
-                        away.wins--;
-                    } else {
-                        home.draws--;
-                        away.draws--;
-                    }
-                }
-            }
+private:
+    Cow<vector<Cow<Stage>>> stages;
+    int teamCount;
+    int recordedEnd;                 // One past the last recorded stage
+
+public:
+    StandingsHistory() : teamCount(0), recordedEnd(0) {}
+
+    // Forget everything; keep history for stageCount stages of teams teams
+    // if the league is within the size limit
+    void reset(int teams, int stageCount) {
+        teamCount = teams;
+        recordedEnd = 0;
+        bool fits = teams <= numeric_limits<uint16_t>::max() &&
+                    static_cast<size_t>(teams) * stageCount <= STANDINGS_HISTORY_MAX_ENTRIES;
+        stages = Cow<vector<Cow<Stage>>>(vector<Cow<Stage>>(fits ? stageCount : 0));
+    }
+
+    bool enabled() const { return !stages.empty(); }
+    int stageCount() const { return stages.size(); }
+
+    bool recorded(int stage) const {
+        return stage >= 0 && stage < recordedEnd && !(*stages)[stage]->empty();
+    }
+
+    // Store the standings after stage. Later stages were played on top of
+    // the old results, so their records go stale and are dropped.
+    void record(int stage, const vector<int>& rankOf, const vector<int32_t>& points,
+                const vector<uint8_t>& outcome) {
+        if (stage < 0 || stage >= stageCount()) return;
+        forgetFrom(stage + 1);
+        Stage& entry = stages.mut()[stage].mut();
+        entry.position.resize(teamCount);
+        entry.points.assign(points.begin(), points.end());
+        entry.outcomes.assign((teamCount + 3) / 4, 0);
+        for (int t = 0; t < teamCount; t++) {
+            entry.position[t] = rankOf[t] + 1;
+            entry.outcomes[t / 4] |= outcome[t] << (t % 4 * 2);
         }
+        recordedEnd = max(recordedEnd, stage + 1);
+    }
 
-        // Play matches
-        for (Match& match : fixtures[stage]) {
-            int homeIndex = findTeamIndex(match.homeTeam);
-            int awayIndex = findTeamIndex(match.awayTeam);
-            
-            if (homeIndex != -1 && awayIndex != -1) {
-                Team& home = teams[homeIndex];
-                Team& away = teams[awayIndex];
-                
-                // Simulate match (simple simulation based on team value)
-                double homeAdvantage = 1.2;
-                double homeStrength = home.value * homeAdvantage;
-                double awayStrength = away.value;
-                double totalStrength = homeStrength + awayStrength;
-                
-                // Generate random goals (0-5)
-                random_device rd;
-                mt19937 gen(rd());
-                poisson_distribution<> homeDist(homeStrength / 50);
-                poisson_distribution<> awayDist(awayStrength / 50);
-                
-                match.homeGoals = min(5, homeDist(gen));
-                match.awayGoals = min(5, awayDist(gen));
-                match.played = true;
-                
-                // Update team statistics
-                home.goalsFor += match.homeGoals;
-                home.goalsAgainst += match.awayGoals;
-                away.goalsFor += match.awayGoals;
-                away.goalsAgainst += match.homeGoals;
-                
-                if (match.homeGoals > match.awayGoals) {
-                    home.wins++;
-                    away.losses++;
-                } else if (match.homeGoals < match.awayGoals) {
-                    home.losses++;
-                    away.wins++;
+    // Drop the records of stage and every later stage (records no fork
+    // shares keep their buffers for the next record)
+    void forgetFrom(int stage) {
+        if (max(stage, 0) < recordedEnd) {
+            vector<Cow<Stage>>& entries = stages.mut();
+            for (int s = max(stage, 0); s < recordedEnd; s++) {
+                if (entries[s].unique()) {
+                    entries[s].mut().clear();
                 } else {
-                    home.draws++;
-                    away.draws++;
+                    entries[s] = Cow<Stage>();
                 }
             }
         }
-        
-        stagesCompleted = stage + 1;
-        cout << "Stage " << stage + 1 << " completed!\n";
-        displayStandings();
+        recordedEnd = min(recordedEnd, max(stage, 0));
+        while (recordedEnd > 0 && (*stages)[recordedEnd - 1]->empty()) {
+            recordedEnd--;
+        }
     }
 
-    // Display standings sorted by points and goal difference
-    void displayStandings() {
-        vector<Team> sorted = teams;
-        sort(sorted.begin(), sorted.end(), 
-            [](const Team& a, const Team& b) {
-                if (a.getPoints() != b.getPoints()) {
-                    return a.getPoints() > b.getPoints();
-                }
-                if (a.getGoalDifference() != b.getGoalDifference()) {
-                    return a.getGoalDifference() > b.getGoalDifference();
-                }
-                return a.goalsFor > b.goalsFor;
-            });
-        
-        // Dynamic width calculation
-        const int nameWidth = 50;  // Max width for team names
-        const int baseWidth = 35;  // Width for other columns
-        
-        cout << "\n--- " << name << " Standings (Stage: " << stagesCompleted << ") ---\n";
-        
-        // Header
-        cout << left << setw(4) << "Pos" 
-             << setw(nameWidth) << "Team"
-             << setw(5) << "Pts"
-             << setw(4) << "W"
-             << setw(4) << "D"
-             << setw(4) << "L"
-             << setw(5) << "GF"
-             << setw(5) << "GA"
-             << setw(5) << "GD"
-             << endl;
-        
-        // Separator
-        cout << string(4 + nameWidth + baseWidth, '-') << endl;
-        
-        for (size_t i = 0; i < sorted.size(); i++) {
-            cout << left << setw(4) << i + 1 
-                 << setw(nameWidth) << truncateString(sorted[i].name, nameWidth)
-                 << setw(5) << sorted[i].getPoints()
-                 << setw(4) << sorted[i].wins
-                 << setw(4) << sorted[i].draws
-                 << setw(4) << sorted[i].losses
-                 << setw(5) << sorted[i].goalsFor
-                 << setw(5) << sorted[i].goalsAgainst
-                 << setw(5) << sorted[i].getGoalDifference()
-                 << endl;
-        }
+    // Position, points and result of a team after a recorded stage
+    int position(int team, int stage) const { return (*stages)[stage]->position[team]; }
+    int points(int team, int stage) const { return (*stages)[stage]->points[team]; }
+    Outcome outcome(int team, int stage) const {
+        return static_cast<Outcome>((*stages)[stage]->outcomes[team / 4] >> (team % 4 * 2) & 3);
     }
 
-    // Export standings to CSV file
-    void exportStandingsToCSV(const string& filename) {
-        ofstream file(filename);
-        if (!file) {
-            cerr << "Error opening file for writing!\n";
-            return;
+    // Points a team took in the window of stages ending at stage: a
+    // difference of two snapshots when the stage before the window is
+    // recorded, otherwise the sum of the recorded results in the window
+    int formPoints(int team, int stage, int window) const {
+        int base = stage - window;
+        if (recorded(base)) {
+            return points(team, stage) - points(team, base);
         }
-        
-        vector<Team> sorted = teams;
-        sort(sorted.begin(), sorted.end(), 
-            [](const Team& a, const Team& b) {
-                return a.getPoints() > b.getPoints();
-            });
-        
-        file << "Position,Team,Points,Wins,Draws,Losses,GF,GA,GD\n";
-        for (size_t i = 0; i < sorted.size(); i++) {
-            file << i + 1 << ","
-                 << sorted[i].name << ","
-                 << sorted[i].getPoints() << ","
-                 << sorted[i].wins << ","
-                 << sorted[i].draws << ","
-                 << sorted[i].losses << ","
-                 << sorted[i].goalsFor << ","
-                 << sorted[i].goalsAgainst << ","
-                 << sorted[i].getGoalDifference() << "\n";
+        int total = 0;
+        for (int s = max(base + 1, 0); s <= stage; s++) {
+            if (!recorded(s)) continue;
+            Outcome result = outcome(team, s);
+            total += result == WIN ? 3 : result == DRAW ? 1 : 0;
         }
-        
-        cout << "Standings exported to " << filename << endl;
+        return total;
     }
 
-    // Get position of a specific team
-    int getTeamPosition(const string& teamName) {
-        vector<Team> sorted = teams;
-        sort(sorted.begin(), sorted.end(), 
-            [](const Team& a, const Team& b) {
-                return a.getPoints() > b.getPoints();
-            });
-        
-        for (size_t i = 0; i < sorted.size(); i++) {
-            if (sorted[i].name == teamName) {
-                return i + 1;
+    static char outcomeLetter(Outcome result) {
+        return "-WDL"[result];
+    }
+
+    // Records as text: the number of recorded stages, then per stage its
+    // number and results ("WDL-"), its positions and its points
+    void save(ostream& out) const {
+        int count = 0;
+        for (int s = 0; s < recordedEnd; s++) {
+            count += recorded(s);
+        }
+        out << count << '\n';
+        for (int s = 0; s < recordedEnd; s++) {
+            if (!recorded(s)) continue;
+            const Stage& entry = *(*stages)[s];
+            out << s << ' ';
+            for (int t = 0; t < teamCount; t++) {
+                out << outcomeLetter(outcome(t, s));
+            }
+            out << '\n';
+            for (int t = 0; t < teamCount; t++) {
+                out << (t ? "," : "") << entry.position[t];
             }
+            out << '\n';
+            for (int t = 0; t < teamCount; t++) {
+                out << (t ? "," : "") << entry.points[t];
+            }
+            out << '\n';
         }
-        return -1;
     }
 
-    // Find team by name (case-insensitive)
-    Team* findTeam(const string& teamName) {
-        for (Team& team : teams) {
-            if (equal(team.name.begin(), team.name.end(), teamName.begin(), teamName.end(),
-                [](char a, char b) { 
-                    return tolower(a) == tolower(b); 
-                })) {
-                return &team;
+    // Read records written by save; records that do not fit are skipped
+    void load(istream& in) {
+        int count = 0;
+        in >> count;
+        in.ignore(numeric_limits<streamsize>::max(), '\n');
+        string line;
+        for (int i = 0; i < count && in; i++) {
+            int s = -1;
+            string letters, positions, points;
+            in >> s >> letters;
+            in.ignore(numeric_limits<streamsize>::max(), '\n');
+            getline(in, positions);
+            getline(in, points);
+            if (s < 0 || s >= stageCount() || static_cast<int>(letters.size()) != teamCount) continue;
+            
+            Stage entry;
+            entry.outcomes.assign((teamCount + 3) / 4, 0);
+            for (int t = 0; t < teamCount; t++) {
+                const char* found = strchr("-WDL", letters[t]);
+                int code = found && *found ? found - "-WDL" : 0;
+                entry.outcomes[t / 4] |= code << (t % 4 * 2);
+            }
+            stringstream positionStream(positions), pointStream(points);
+            string token;
+            while (getline(positionStream, token, ',')) {
+                entry.position.push_back(stoi(token));
+            }
+            while (getline(pointStream, token, ',')) {
+                entry.points.push_back(stoi(token));
             }
+            if (static_cast<int>(entry.position.size()) != teamCount ||
+                static_cast<int>(entry.points.size()) != teamCount) {
+                continue;
+            }
+            stages.mut()[s] = Cow<Stage>(move(entry));
+            recordedEnd = max(recordedEnd, s + 1);
         }
-        return nullptr;
     }
+};
 
-    // Display standings sorted by team value
-    void displayValueStandings() {
-        vector<Team> sorted = teams;
-        sort(sorted.begin(), sorted.end(), 
-            [](const Team& a, const Team& b) {
-                return a.value > b.value;
-            });
-        
-        const int nameWidth = 50;
-        
-        cout << "\n--- " << name << " Value-Based Standings ---\n";
-        cout << left << setw(4) << "Pos" 
-             << setw(nameWidth) << "Team"
-             << "Value (M€)\n";
-        cout << string(4 + nameWidth + 15, '-') << endl;
-        
-        for (size_t i = 0; i < sorted.size(); i++) {
-            cout << left << setw(4) << i + 1 
-                 << setw(nameWidth) << truncateString(sorted[i].name, nameWidth)
-                 << sorted[i].value << "M\n";
-        }
+// Binary snapshot format (championship_data.bin).
+// Layout: header, one ChampionshipRecord per championship, fixed-width
+// team/match/name records, then a string table holding all names. All
+// offsets are from the start of the file and 8-byte aligned so the records
+// can be read in place from a memory-mapped file.
+const char SNAPSHOT_MAGIC[8] = {'F', 'C', 'M', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t SNAPSHOT_VERSION = 2;  // 2: generated schedules stored as a roster
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t championshipCount;
+    uint64_t championshipsOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+};
+
+struct SnapshotString {
+    uint32_t offset;  // Into the string table
+    uint32_t length;
+};
+
+struct SnapshotChampionship {
+    SnapshotString name;
+    uint32_t teamCount;
+    uint32_t nameCount;      // Interned team IDs
+    int32_t stagesCompleted;
+    int32_t totalStages;
+    uint64_t seed;
+    uint32_t stageCount;
+    uint32_t matchCount;     // Across all stages
+    uint64_t teamsOffset;    // SnapshotTeam[teamCount]
+    uint64_t namesOffset;    // SnapshotString[nameCount], indexed by team ID
+    uint64_t stagesOffset;   // uint32_t[stageCount] matches per stage
+    uint64_t matchesOffset;  // SnapshotMatch[matchCount]
+    uint32_t rosterCount;    // Circle-method roster (0: fixtures stored explicitly)
+    uint32_t tieBreaks;      // TieBreakRules::pack() (0: standard rules)
+    uint64_t rosterOffset;   // int32_t[rosterCount], padded with BYE
+};
+
+// Version 1 records end before the roster fields
+const size_t SNAPSHOT_CHAMPIONSHIP_V1_SIZE = offsetof(SnapshotChampionship, rosterCount);
+
+struct SnapshotTeam {
+    int32_t id;
+    int32_t wins;
+    double value;
+    int32_t draws;
+    int32_t losses;
+    int32_t goalsFor;
+    int32_t goalsAgainst;
+};
+
+struct SnapshotMatch {
+    int32_t homeId;
+    int32_t awayId;
+    uint8_t homeGoals;
+    uint8_t awayGoals;
+    uint8_t played;
+    uint8_t reserved;
+};
+
+// Accumulates a snapshot in memory so it can be written with a single call
+class SnapshotWriter {
+private:
+    vector<char> body;
+    vector<char> strings;
+
+public:
+    SnapshotWriter() : body(sizeof(SnapshotHeader), 0) {}
+
+    // Append an array of records, returning its file offset
+    template <typename T>
+    uint64_t append(const T* records, size_t count) {
+        body.resize((body.size() + 7) & ~size_t(7), 0);
+        uint64_t offset = body.size();
+        const char* bytes = reinterpret_cast<const char*>(records);
+        body.insert(body.end(), bytes, bytes + sizeof(T) * count);
+        return offset;
+    }
+
+    // Reserve space for records that are filled in later
+    template <typename T>
+    uint64_t reserve(size_t count) {
+        body.resize((body.size() + 7) & ~size_t(7), 0);
+        uint64_t offset = body.size();
+        body.resize(body.size() + sizeof(T) * count, 0);
+        return offset;
+    }
+
+    template <typename T>
+    T* at(uint64_t offset) {
+        return reinterpret_cast<T*>(body.data() + offset);
+    }
+
+    SnapshotString addString(const string& str) {
+        SnapshotString ref = {static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(str.size())};
+        strings.insert(strings.end(), str.begin(), str.end());
+        return ref;
+    }
+
+    // Finish the header and write everything to disk
+    bool writeTo(const string& filename, uint32_t championshipCount, uint64_t championshipsOffset) {
+        body.resize((body.size() + 7) & ~size_t(7), 0);
+        SnapshotHeader* header = at<SnapshotHeader>(0);
+        memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+        header->version = SNAPSHOT_VERSION;
+        header->championshipCount = championshipCount;
+        header->championshipsOffset = championshipsOffset;
+        header->stringsOffset = body.size();
+        header->stringsSize = strings.size();
+
+        ofstream file(filename, ios::binary);
+        if (!file) {
+            return false;
+        }
+        file.write(body.data(), body.size());
+        file.write(strings.data(), strings.size());
+        return static_cast<bool>(file);
+    }
+};
+
+// Read-only view of a whole file, memory-mapped where the platform allows
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+#ifdef _WIN32
+    vector<char> buffer;
+#endif
+
+public:
+    MappedFile() : data(nullptr), length(0) {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (data) munmap(const_cast<char*>(data), length);
+#endif
+    }
+
+    bool open(const string& filename) {
+#ifdef _WIN32
+        ifstream file(filename, ios::binary);
+        if (!file) return false;
+        buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        data = buffer.data();
+        length = buffer.size();
+        return true;
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) return false;
+        data = static_cast<const char*>(mapped);
+        length = info.st_size;
+        return true;
+#endif
+    }
+
+    size_t size() const { return length; }
+
+    // Bounds-checked typed view of count records at offset (nullptr if out of range)
+    template <typename T>
+    const T* view(uint64_t offset, uint64_t count = 1) const {
+        if (offset % alignof(T) != 0 || offset > length ||
+            count > (length - offset) / sizeof(T)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(data + offset);
+    }
+
+    // String from the snapshot string table (false if out of range)
+    bool readString(const SnapshotHeader& header, const SnapshotString& ref, string& out) const {
+        if (ref.offset > header.stringsSize || ref.length > header.stringsSize - ref.offset ||
+            header.stringsOffset + header.stringsSize > length) {
+            return false;
+        }
+        out.assign(data + header.stringsOffset + ref.offset, ref.length);
+        return true;
+    }
+};
+
+// ===== Archive format =====
+
+// Compact archive of championships (championship_archive.fca), encoded and
+// decoded as a stream. Integers are LEB128 varints (signed ones
+// zigzag-encoded) and team IDs are delta-encoded. A stage whose matches were
+// all played with scores below 16 stores one byte per match (home << 4 |
+// away). Team statistics are stored as their difference from what the
+// stored results add up to, which is zero for seasons played in this program.
+const char ARCHIVE_MAGIC[4] = {'F', 'C', 'M', 'A'};
+const uint32_t ARCHIVE_VERSION = 1;
+const uint64_t ARCHIVE_MAX_COUNT = 1 << 24;     // Teams, names, stages or matches
+const uint64_t ARCHIVE_MAX_STRING = 1 << 16;
+
+// How a stage's results are stored
+enum ArchiveStage : uint8_t { ARCHIVE_STAGE_EMPTY, ARCHIVE_STAGE_PACKED, ARCHIVE_STAGE_FULL };
+
+// Buffered encoder writing to a stream
+class ArchiveWriter {
+private:
+    static const size_t BUFFER_SIZE = 1 << 16;
+    ostream& out;
+    string buffer;
+
+public:
+    explicit ArchiveWriter(ostream& out) : out(out) { buffer.reserve(BUFFER_SIZE); }
+    ~ArchiveWriter() { flush(); }
+
+    void byte(uint8_t value) {
+        buffer += static_cast<char>(value);
+        if (buffer.size() >= BUFFER_SIZE) flush();
+    }
+
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            byte(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        byte(static_cast<uint8_t>(value));
+    }
+
+    void signedVarint(int64_t value) {
+        varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void str(const string& text) {
+        varint(text.size());
+        buffer += text;
+        if (buffer.size() >= BUFFER_SIZE) flush();
+    }
+
+    // IEEE 754 bits, little-endian
+    void real(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; i++) {
+            byte(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+    }
+
+    bool flush() {
+        out.write(buffer.data(), buffer.size());
+        buffer.clear();
+        return static_cast<bool>(out);
+    }
+};
+
+// Buffered decoder reading from a stream. Truncated or malformed input sets
+// failed() and reads as zeros from then on.
+class ArchiveReader {
+private:
+    istream& in;
+    vector<char> buffer;
+    size_t position;
+    size_t end;
+    bool bad;
+
+    bool refill() {
+        if (bad) return false;
+        in.read(buffer.data(), buffer.size());
+        end = in.gcount();
+        position = 0;
+        return end > 0;
+    }
+
+public:
+    explicit ArchiveReader(istream& in) : in(in), buffer(1 << 16), position(0), end(0), bad(false) {}
+
+    bool failed() const { return bad; }
+    void fail() { bad = true; }
+
+    uint8_t byte() {
+        if (position == end && !refill()) {
+            bad = true;
+            return 0;
+        }
+        return static_cast<uint8_t>(buffer[position++]);
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return value;
+        }
+        bad = true;
+        return 0;
+    }
+
+    int64_t signedVarint() {
+        uint64_t value = varint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // A count, failing above limit so corrupt input cannot force huge allocations
+    uint64_t count(uint64_t limit = ARCHIVE_MAX_COUNT) {
+        uint64_t value = varint();
+        if (value > limit) {
+            bad = true;
+            return 0;
+        }
+        return value;
+    }
+
+    string str() {
+        size_t length = count(ARCHIVE_MAX_STRING);
+        string text;
+        text.reserve(length);
+        while (text.size() < length && !bad) {
+            if (position == end && !refill()) {
+                bad = true;
+                break;
+            }
+            size_t take = min(length - text.size(), end - position);
+            text.append(buffer.data() + position, take);
+            position += take;
+        }
+        return text;
+    }
+
+    double real() {
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; i++) {
+            bits |= static_cast<uint64_t>(byte()) << (8 * i);
+        }
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+// ===== Rank statistics =====
+
+// Metrics the comparison report can rank teams by (larger ranks higher)
+enum class Metric { POINTS, VALUE, GOAL_DIFFERENCE, GOALS_FOR, POINTS_PER_VALUE };
+
+struct MetricInfo {
+    const char* name;     // Command-line name
+    const char* label;    // Report column label
+};
+const MetricInfo METRICS[] = {
+    {"points", "Pts Pos"},
+    {"value", "Val Pos"},
+    {"gd", "GD Pos"},
+    {"gf", "GF Pos"},
+    {"points-per-value", "PPV Pos"},
+};
+
+bool parseMetric(const string& text, Metric& metric) {
+    for (int i = 0; i < static_cast<int>(size(METRICS)); i++) {
+        if (text == METRICS[i].name) {
+            metric = static_cast<Metric>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Ranks (1 = largest) with tied values sharing the average of their ranks
+vector<double> averageRanks(const vector<double>& values) {
+    size_t n = values.size();
+    vector<int> order(n);
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](int a, int b) { return values[a] > values[b]; });
+    vector<double> ranks(n);
+    for (size_t first = 0; first < n; ) {
+        size_t last = first + 1;
+        while (last < n && values[order[last]] == values[order[first]]) last++;
+        double rank = (first + 1 + last) / 2.0;
+        for (size_t i = first; i < last; i++) {
+            ranks[order[i]] = rank;
+        }
+        first = last;
+    }
+    return ranks;
+}
+
+// Spearman's rho: Pearson correlation of the average ranks (0 if undefined)
+double spearmanRho(const vector<double>& x, const vector<double>& y) {
+    vector<double> rx = averageRanks(x), ry = averageRanks(y);
+    size_t n = x.size();
+    if (n < 2) return 0.0;
+    double mean = (n + 1) / 2.0;
+    double sxy = 0.0, sxx = 0.0, syy = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sxy += (rx[i] - mean) * (ry[i] - mean);
+        sxx += (rx[i] - mean) * (rx[i] - mean);
+        syy += (ry[i] - mean) * (ry[i] - mean);
+    }
+    return sxx > 0 && syy > 0 ? sxy / sqrt(sxx * syy) : 0.0;
+}
+
+// Kendall's tau-b in O(n log n) (Knight's algorithm): sort by (x, y), count
+// the discordant pairs as the swaps of a merge sort on y, and correct for
+// ties in x, in y and in both (0 if undefined)
+double kendallTauB(const vector<double>& x, const vector<double>& y) {
+    size_t n = x.size();
+    if (n < 2) return 0.0;
+    vector<int> order(n);
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](int a, int b) {
+        return x[a] != x[b] ? x[a] < x[b] : y[a] < y[b];
+    });
+
+    auto tiedPairs = [](long long run) { return run * (run - 1) / 2; };
+    long long tiedX = 0, tiedBoth = 0;
+    for (size_t first = 0; first < n; ) {
+        size_t last = first + 1;
+        while (last < n && x[order[last]] == x[order[first]]) last++;
+        tiedX += tiedPairs(last - first);
+        for (size_t sub = first; sub < last; ) {
+            size_t end = sub + 1;
+            while (end < last && y[order[end]] == y[order[sub]]) end++;
+            tiedBoth += tiedPairs(end - sub);
+            sub = end;
+        }
+        first = last;
+    }
+
+    // Bottom-up merge sort of y values in x order, counting strict inversions
+    vector<double> values(n), buffer(n);
+    for (size_t i = 0; i < n; i++) {
+        values[i] = y[order[i]];
+    }
+    long long swaps = 0;
+    for (size_t width = 1; width < n; width *= 2) {
+        for (size_t left = 0; left < n; left += 2 * width) {
+            size_t mid = min(left + width, n), right = min(left + 2 * width, n);
+            size_t i = left, j = mid, k = left;
+            while (i < mid && j < right) {
+                if (values[j] < values[i]) {
+                    swaps += mid - i;
+                    buffer[k++] = values[j++];
+                } else {
+                    buffer[k++] = values[i++];
+                }
+            }
+            while (i < mid) buffer[k++] = values[i++];
+            while (j < right) buffer[k++] = values[j++];
+        }
+        values.swap(buffer);
+    }
+
+    long long tiedY = 0;
+    for (size_t first = 0; first < n; ) {
+        size_t last = first + 1;
+        while (last < n && values[last] == values[first]) last++;
+        tiedY += tiedPairs(last - first);
+        first = last;
+    }
+
+    long long pairs = tiedPairs(n);
+    double denominator = sqrt(static_cast<double>(pairs - tiedX) * static_cast<double>(pairs - tiedY));
+    if (denominator == 0) return 0.0;
+    return (pairs - tiedX - tiedY + tiedBoth - 2 * swaps) / denominator;
+}
+
+// Positions of every team under two metrics and how well they agree
+struct MetricComparison {
+    Metric first, second;
+    vector<int> firstPosition;     // Team index -> 1-based position
+    vector<int> secondPosition;
+    double spearman;
+    double kendall;
+
+    MetricComparison() : first(Metric::POINTS), second(Metric::VALUE), spearman(0.0), kendall(0.0) {}
+};
+
+// Largest league the season simulation accepts: the position table has one
+// 32-bit counter per team and position (64 MiB at this size)
+const int SIMULATION_MAX_TEAMS = 4096;
+// Finishing orders a simulation worker buffers before adding them to the shared table
+const int SIMULATION_MERGE_SEASONS = 64;
+
+// Final position histogram produced by a Monte Carlo season simulation
+struct SimulationResult {
+    int seasons;
+    int teamCount;
+    vector<string> teamNames;
+    vector<uint32_t> positionCounts;   // teamCount x teamCount, row = team, column = position
+    vector<double> averagePoints;
+
+    SimulationResult() : seasons(0), teamCount(0) {}
+
+    // Probability (0-1) of a team finishing in a given position (0-based)
+    double probability(int team, int position) const {
+        if (seasons == 0) return 0.0;
+        return static_cast<double>(positionCounts[static_cast<size_t>(team) * teamCount + position]) / seasons;
+    }
+
+    // Probability (0-1) of a team finishing within positions [first, last)
+    double rangeProbability(int team, int first, int last) const {
+        double total = 0.0;
+        for (int pos = max(0, first); pos < min(last, teamCount); pos++) {
+            total += probability(team, pos);
+        }
+        return total;
+    }
+};
+
+// Dinic max-flow over a graph whose buffers are kept between runs, so
+// rebuilding it for another team or stage does not allocate. Edges are
+// stored in pairs: the reverse of edge e is e ^ 1. Edges may start with a
+// flow already on them (e.g. from a greedy first pass), and maxFlow only
+// finds the flow that can be added on top.
+class FlowNetwork {
+private:
+    vector<int> head, next, target, capacity;
+    vector<int> level, cursor, queue;
+
+    // Breadth-first levels from the source (false once the sink is unreachable)
+    bool buildLevels(int source, int sink) {
+        level.assign(head.size(), -1);
+        queue.clear();
+        queue.push_back(source);
+        level[source] = 0;
+        for (size_t i = 0; i < queue.size(); i++) {
+            int node = queue[i];
+            for (int e = head[node]; e != -1; e = next[e]) {
+                if (capacity[e] > 0 && level[target[e]] < 0) {
+                    level[target[e]] = level[node] + 1;
+                    queue.push_back(target[e]);
+                }
+            }
+        }
+        return level[sink] >= 0;
+    }
+
+    // Push up to limit units from node along the level graph
+    int augment(int node, int sink, int limit) {
+        if (node == sink) return limit;
+        int total = 0;
+        for (int& e = cursor[node]; e != -1 && total < limit; ) {
+            int to = target[e];
+            if (capacity[e] > 0 && level[to] == level[node] + 1) {
+                int pushed = augment(to, sink, min(limit - total, capacity[e]));
+                capacity[e] -= pushed;
+                capacity[e ^ 1] += pushed;
+                total += pushed;
+                if (capacity[e] > 0 && total < limit) {
+                    e = next[e];  // The rest of this edge is blocked downstream
+                }
+            } else {
+                e = next[e];
+            }
+        }
+        return total;
+    }
+
+public:
+    // Start an empty graph of nodeCount nodes
+    void reset(int nodeCount) {
+        head.assign(nodeCount, -1);
+        next.clear();
+        target.clear();
+        capacity.clear();
+    }
+
+    int addNode() {
+        head.push_back(-1);
+        return head.size() - 1;
+    }
+
+    void addEdge(int from, int to, int cap, int flow = 0) {
+        next.push_back(head[from]);
+        target.push_back(to);
+        capacity.push_back(cap - flow);
+        head[from] = target.size() - 1;
+        next.push_back(head[to]);
+        target.push_back(from);
+        capacity.push_back(flow);
+        head[to] = target.size() - 1;
+    }
+
+    long long maxFlow(int source, int sink) {
+        long long flow = 0;
+        while (buildLevels(source, sink)) {
+            cursor.assign(head.begin(), head.end());
+            flow += augment(source, sink, numeric_limits<int>::max());
+        }
+        return flow;
+    }
+};
+
+// What each team can still achieve given the points so far and the remaining
+// fixtures, in standings order. A status is only CLINCHED or ELIMINATED when
+// it is mathematically certain (points ties count as still open).
+struct SeasonOutlook {
+    enum Status : char { OPEN = '-', CLINCHED = 'C', ELIMINATED = 'E' };
+
+    int remainingMatches;
+    int relegationSpots;
+    vector<string> teamNames;
+    vector<int> points;
+    vector<int> maxPoints;
+    vector<Status> title;
+    vector<Status> safety;           // CLINCHED: safe, ELIMINATED: relegated
+
+    SeasonOutlook() : remainingMatches(0), relegationSpots(0) {}
+
+    int size() const { return teamNames.size(); }
+};
+
+// Structure-of-arrays statistics for all teams of a championship.
+// Raw results live in parallel arrays; points, goal difference and a packed
+// standings key are derived from them by refresh()/refreshAll().
+struct TeamStatsBlock {
+    vector<int32_t> wins;
+    vector<int32_t> draws;
+    vector<int32_t> losses;
+    vector<int32_t> goalsFor;
+    vector<int32_t> goalsAgainst;
+    vector<int32_t> points;
+    vector<int32_t> goalDifference;
+    vector<uint64_t> sortKey;  // Larger key ranks higher
+
+    // Key layout: points (20 bits) | goal difference + 2^21 (22 bits) | goals for (22 bits)
+    static constexpr int KEY_GD_SHIFT = 22;
+    static constexpr int KEY_POINTS_SHIFT = 44;
+    static constexpr int32_t KEY_GD_BIAS = 1 << 21;
+    static constexpr int32_t KEY_MAX_POINTS = (1 << 20) - 1;
+    static constexpr int32_t KEY_MAX_GOALS = (1 << 22) - 1;
+
+    static uint64_t packKey(int32_t pts, int32_t gd, int32_t gf) {
+        pts = max(0, min(pts, KEY_MAX_POINTS));
+        gd = max(-KEY_GD_BIAS, min(gd, KEY_GD_BIAS - 1)) + KEY_GD_BIAS;
+        gf = max(0, min(gf, KEY_MAX_GOALS));
+        return (static_cast<uint64_t>(pts) << KEY_POINTS_SHIFT) |
+               (static_cast<uint64_t>(gd) << KEY_GD_SHIFT) |
+               static_cast<uint64_t>(gf);
+    }
+
+    size_t size() const { return wins.size(); }
+
+    void push(const Team& team) {
+        wins.push_back(team.wins);
+        draws.push_back(team.draws);
+        losses.push_back(team.losses);
+        goalsFor.push_back(team.goalsFor);
+        goalsAgainst.push_back(team.goalsAgainst);
+        points.push_back(0);
+        goalDifference.push_back(0);
+        sortKey.push_back(0);
+        refresh(size() - 1);
+    }
+
+    void erase(size_t i) {
+        wins.erase(wins.begin() + i);
+        draws.erase(draws.begin() + i);
+        losses.erase(losses.begin() + i);
+        goalsFor.erase(goalsFor.begin() + i);
+        goalsAgainst.erase(goalsAgainst.begin() + i);
+        points.erase(points.begin() + i);
+        goalDifference.erase(goalDifference.begin() + i);
+        sortKey.erase(sortKey.begin() + i);
+    }
+
+    void clear() {
+        for (vector<int32_t>* column : {&wins, &draws, &losses, &goalsFor, &goalsAgainst,
+                                        &points, &goalDifference}) {
+            column->clear();
+        }
+        sortKey.clear();
+    }
+
+    void reserve(size_t n) {
+        for (vector<int32_t>* column : {&wins, &draws, &losses, &goalsFor, &goalsAgainst,
+                                        &points, &goalDifference}) {
+            column->reserve(n);
+        }
+        sortKey.reserve(n);
+    }
+
+    // Zero all results (keeps the team count)
+    void resetAll() {
+        for (vector<int32_t>* column : {&wins, &draws, &losses, &goalsFor, &goalsAgainst}) {
+            fill(column->begin(), column->end(), 0);
+        }
+        refreshAll();
+    }
+
+    // Recompute derived values for one team
+    void refresh(size_t i) {
+        points[i] = wins[i] * 3 + draws[i];
+        goalDifference[i] = goalsFor[i] - goalsAgainst[i];
+        sortKey[i] = packKey(points[i], goalDifference[i], goalsFor[i]);
+    }
+
+    // Recompute derived values for every team in one pass (AVX2 when available)
+    void refreshAll() {
+        size_t n = size();
+        size_t i = 0;
+#ifdef __AVX2__
+        const __m256i three = _mm256_set1_epi32(3);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i maxPoints = _mm256_set1_epi32(KEY_MAX_POINTS);
+        const __m256i maxGoals = _mm256_set1_epi32(KEY_MAX_GOALS);
+        const __m256i minGd = _mm256_set1_epi32(-KEY_GD_BIAS);
+        const __m256i maxGd = _mm256_set1_epi32(KEY_GD_BIAS - 1);
+        const __m256i gdBias = _mm256_set1_epi32(KEY_GD_BIAS);
+        for (; i + 8 <= n; i += 8) {
+            __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&wins[i]));
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&draws[i]));
+            __m256i gf = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&goalsFor[i]));
+            __m256i ga = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&goalsAgainst[i]));
+            __m256i pts = _mm256_add_epi32(_mm256_mullo_epi32(w, three), d);
+            __m256i gd = _mm256_sub_epi32(gf, ga);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&points[i]), pts);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&goalDifference[i]), gd);
+
+            // Clamp into key fields, then widen to 64-bit lanes and pack
+            __m256i kp = _mm256_min_epi32(_mm256_max_epi32(pts, zero), maxPoints);
+            __m256i kd = _mm256_add_epi32(_mm256_min_epi32(_mm256_max_epi32(gd, minGd), maxGd), gdBias);
+            __m256i kf = _mm256_min_epi32(_mm256_max_epi32(gf, zero), maxGoals);
+            for (int half = 0; half < 2; half++) {
+                __m128i p4 = half ? _mm256_extracti128_si256(kp, 1) : _mm256_castsi256_si128(kp);
+                __m128i d4 = half ? _mm256_extracti128_si256(kd, 1) : _mm256_castsi256_si128(kd);
+                __m128i f4 = half ? _mm256_extracti128_si256(kf, 1) : _mm256_castsi256_si128(kf);
+                __m256i key = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_slli_epi64(_mm256_cvtepu32_epi64(p4), KEY_POINTS_SHIFT),
+                                    _mm256_slli_epi64(_mm256_cvtepu32_epi64(d4), KEY_GD_SHIFT)),
+                    _mm256_cvtepu32_epi64(f4));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(&sortKey[i + half * 4]), key);
+            }
+        }
+#endif
+        for (; i < n; i++) {
+            refresh(i);
+        }
+    }
+
+    // Raw counters only; call refreshAll() after a batch of results
+    void addResult(size_t home, size_t away, int homeGoals, int awayGoals, int sign) {
+        goalsFor[home] += sign * homeGoals;
+        goalsAgainst[home] += sign * awayGoals;
+        goalsFor[away] += sign * awayGoals;
+        goalsAgainst[away] += sign * homeGoals;
+
+        if (homeGoals > awayGoals) {
+            wins[home] += sign;
+            losses[away] += sign;
+        } else if (homeGoals < awayGoals) {
+            losses[home] += sign;
+            wins[away] += sign;
+        } else {
+            draws[home] += sign;
+            draws[away] += sign;
+        }
+    }
+
+    // Copy the statistics of one team into a Team view
+    void copyTo(size_t i, Team& team) const {
+        team.wins = wins[i];
+        team.draws = draws[i];
+        team.losses = losses[i];
+        team.goalsFor = goalsFor[i];
+        team.goalsAgainst = goalsAgainst[i];
+    }
+};
+
+// Head-to-head record of every pair of teams (row team against column team),
+// updated with each result so tie-breaks never rescan the fixtures. It is
+// only kept while the tie-break rules use it, for leagues of up to
+// HEAD_TO_HEAD_MAX_TEAMS teams (6 bytes per pair).
+const int HEAD_TO_HEAD_MAX_TEAMS = 2048;
+
+class HeadToHeadMatrix {
+public:
+    struct Cell {
+        int16_t points;      // Points the row team took from the column team
+        int16_t goals;       // Goals the row team scored against it
+        int16_t awayGoals;   // Of those, goals scored away
+    };
+
+private:
+    int teamCount;
+    vector<Cell> cells;
+
+public:
+    HeadToHeadMatrix() : teamCount(0) {}
+
+    // Zero the matrix for teamCount teams
+    void reset(int count) {
+        teamCount = count;
+        cells.assign(static_cast<size_t>(count) * count, Cell{0, 0, 0});
+    }
+
+    // Drop the matrix and its memory
+    void clear() {
+        teamCount = 0;
+        vector<Cell>().swap(cells);
+    }
+
+    int size() const { return teamCount; }
+    bool empty() const { return teamCount == 0; }
+
+    const Cell& at(int row, int column) const {
+        return cells[static_cast<size_t>(row) * teamCount + column];
+    }
+
+    // Add (sign = +1) or remove (sign = -1) one match result
+    void addResult(int home, int away, int homeGoals, int awayGoals, int sign) {
+        Cell& homeCell = cells[static_cast<size_t>(home) * teamCount + away];
+        Cell& awayCell = cells[static_cast<size_t>(away) * teamCount + home];
+        homeCell.goals += sign * homeGoals;
+        awayCell.goals += sign * awayGoals;
+        awayCell.awayGoals += sign * awayGoals;
+        if (homeGoals > awayGoals) {
+            homeCell.points += 3 * sign;
+        } else if (homeGoals < awayGoals) {
+            awayCell.points += 3 * sign;
+        } else {
+            homeCell.points += sign;
+            awayCell.points += sign;
+        }
+    }
+};
+
+// Criteria that order teams level on points, applied in turn
+enum class TieBreak : uint8_t {
+    GOAL_DIFFERENCE = 1,
+    GOALS_FOR,
+    HEAD_TO_HEAD_POINTS,
+    HEAD_TO_HEAD_GOAL_DIFFERENCE,
+    HEAD_TO_HEAD_GOALS,
+    HEAD_TO_HEAD_AWAY_GOALS,
+};
+
+const char* const TIE_BREAK_NAMES[] = {"", "gd", "gf", "h2h-points", "h2h-gd", "h2h-goals", "h2h-away"};
+const int TIE_BREAK_COUNT = 6;
+
+// Scratch buffers for resolving tied groups
+struct TieBreakScratch {
+    vector<int> keys;     // Criterion values, one row per team of the group
+    vector<int> group;    // Group-local indices being sorted
+    vector<int> members;  // Team indices of the group
+};
+
+// Tie-break chain applied after points. The standard chain (goal difference,
+// goals for) is what the packed ranking key already encodes; other chains
+// re-order each group of teams level on points. Head-to-head criteria are
+// computed once over the mini-league of matches between the group's teams.
+// Teams still level keep registration order.
+class TieBreakRules {
+private:
+    vector<TieBreak> chain;
+
+public:
+    TieBreakRules() : chain{TieBreak::GOAL_DIFFERENCE, TieBreak::GOALS_FOR} {}
+
+    bool isStandard() const {
+        return chain.size() == 2 && chain[0] == TieBreak::GOAL_DIFFERENCE && chain[1] == TieBreak::GOALS_FOR;
+    }
+
+    bool usesHeadToHead() const {
+        for (TieBreak criterion : chain) {
+            if (criterion >= TieBreak::HEAD_TO_HEAD_POINTS) return true;
+        }
+        return false;
+    }
+
+    // Parse a comma-separated chain such as "h2h-points,h2h-gd,gd" or
+    // "standard" (false on unknown or repeated criteria)
+    bool parse(const string& text) {
+        if (text == "standard") {
+            *this = TieBreakRules();
+            return true;
+        }
+        vector<TieBreak> parsed;
+        stringstream ss(text);
+        string token;
+        while (getline(ss, token, ',')) {
+            int code = 1;
+            while (code <= TIE_BREAK_COUNT && token != TIE_BREAK_NAMES[code]) code++;
+            TieBreak criterion = static_cast<TieBreak>(code);
+            if (code > TIE_BREAK_COUNT || find(parsed.begin(), parsed.end(), criterion) != parsed.end()) {
+                return false;
+            }
+            parsed.push_back(criterion);
+        }
+        if (parsed.empty()) return false;
+        chain = parsed;
+        return true;
+    }
+
+    string toString() const {
+        if (isStandard()) return "standard";
+        string text;
+        for (TieBreak criterion : chain) {
+            text += (text.empty() ? "" : ",") + string(TIE_BREAK_NAMES[static_cast<int>(criterion)]);
+        }
+        return text;
+    }
+
+    // Snapshot encoding: one criterion per 4 bits, lowest first; 0 is the standard chain
+    uint32_t pack() const {
+        uint32_t packed = 0;
+        if (!isStandard()) {
+            for (size_t i = 0; i < chain.size(); i++) {
+                packed |= static_cast<uint32_t>(chain[i]) << (4 * i);
+            }
+        }
+        return packed;
+    }
+
+    bool unpack(uint32_t packed) {
+        vector<TieBreak> unpacked;
+        for (; packed != 0; packed >>= 4) {
+            int code = packed & 0xF;
+            TieBreak criterion = static_cast<TieBreak>(code);
+            if (code < 1 || code > TIE_BREAK_COUNT ||
+                find(unpacked.begin(), unpacked.end(), criterion) != unpacked.end()) {
+                return false;
+            }
+            unpacked.push_back(criterion);
+        }
+        *this = TieBreakRules();
+        if (!unpacked.empty()) chain = unpacked;
+        return true;
+    }
+
+    // Re-order every run of teams level on points in order, which must be
+    // sorted by points. The matrix is ignored unless it covers every team.
+    template <typename Points, typename GoalDifference, typename GoalsFor>
+    void resolve(vector<int>& order, Points points, GoalDifference goalDifference, GoalsFor goalsFor,
+                 const HeadToHeadMatrix& matrix, TieBreakScratch& scratch) const {
+        size_t k = chain.size();
+        bool headToHead = usesHeadToHead() && matrix.size() == static_cast<int>(order.size());
+        for (size_t first = 0; first < order.size(); ) {
+            size_t last = first + 1;
+            while (last < order.size() && points(order[last]) == points(order[first])) last++;
+            size_t g = last - first;
+            if (g > 1) {
+                scratch.members.assign(order.begin() + first, order.begin() + last);
+                scratch.keys.assign(g * k, 0);
+                for (size_t a = 0; a < g; a++) {
+                    int team = scratch.members[a];
+                    int h2hPoints = 0, h2hFor = 0, h2hAgainst = 0, h2hAway = 0;
+                    for (size_t b = 0; headToHead && b < g; b++) {
+                        int other = scratch.members[b];
+                        const HeadToHeadMatrix::Cell& cell = matrix.at(team, other);
+                        h2hPoints += cell.points;
+                        h2hFor += cell.goals;
+                        h2hAway += cell.awayGoals;
+                        h2hAgainst += matrix.at(other, team).goals;
+                    }
+                    int* keys = &scratch.keys[a * k];
+                    for (size_t c = 0; c < k; c++) {
+                        switch (chain[c]) {
+                            case TieBreak::GOAL_DIFFERENCE: keys[c] = goalDifference(team); break;
+                            case TieBreak::GOALS_FOR: keys[c] = goalsFor(team); break;
+                            case TieBreak::HEAD_TO_HEAD_POINTS: keys[c] = h2hPoints; break;
+                            case TieBreak::HEAD_TO_HEAD_GOAL_DIFFERENCE: keys[c] = h2hFor - h2hAgainst; break;
+                            case TieBreak::HEAD_TO_HEAD_GOALS: keys[c] = h2hFor; break;
+                            case TieBreak::HEAD_TO_HEAD_AWAY_GOALS: keys[c] = h2hAway; break;
+                        }
+                    }
+                }
+                scratch.group.resize(g);
+                iota(scratch.group.begin(), scratch.group.end(), 0);
+                sort(scratch.group.begin(), scratch.group.end(), [&](int a, int b) {
+                    const int* x = &scratch.keys[a * k];
+                    const int* y = &scratch.keys[b * k];
+                    for (size_t c = 0; c < k; c++) {
+                        if (x[c] != y[c]) return x[c] > y[c];
+                    }
+                    return scratch.members[a] < scratch.members[b];
+                });
+                for (size_t a = 0; a < g; a++) {
+                    order[first + a] = scratch.members[scratch.group[a]];
+                }
+            }
+            first = last;
+        }
+    }
+};
+
+// Stable LSD radix sort of team indices by descending 64-bit key.
+// The key holds points, goal difference and goals for; equal keys keep
+// ascending index order, which is the final (registration order) tie-break.
+// Byte positions where every key has the same digit are skipped, and very
+// large tables split counting and scattering across threads.
+const size_t RADIX_MIN_TEAMS = 2048;            // Below this std::sort is faster
+const size_t RADIX_PARALLEL_MIN_TEAMS = 1 << 17;
+
+void radixRankByKey(const vector<uint64_t>& keys, vector<int>& order, int threadCount = 0) {
+    struct Entry { uint64_t key; int32_t index; };
+    const int RADIX_BITS = 8;
+    const int BUCKETS = 1 << RADIX_BITS;
+    const int PASSES = 64 / RADIX_BITS;
+    size_t n = keys.size();
+
+    // Complemented keys sort ascending into descending standings order
+    vector<Entry> current(n), next(n);
+    for (size_t i = 0; i < n; i++) {
+        current[i] = {~keys[i], static_cast<int32_t>(i)};
+    }
+
+    if (threadCount <= 0) {
+        threadCount = n >= RADIX_PARALLEL_MIN_TEAMS ? max(1u, thread::hardware_concurrency()) : 1;
+    }
+    threadCount = max(1, min<int>(threadCount, n / 4096 + 1));
+
+    // Run body(t, first, last) over thread-sized chunks of the table
+    auto forEachChunk = [&](auto body) {
+        if (threadCount == 1) {
+            body(0, size_t(0), n);
+            return;
+        }
+        vector<thread> workers;
+        for (int t = 0; t < threadCount; t++) {
+            workers.emplace_back(body, t, n * t / threadCount, n * (t + 1) / threadCount);
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+    };
+
+    vector<array<size_t, BUCKETS>> counts(threadCount);
+    for (int pass = 0; pass < PASSES; pass++) {
+        int shift = pass * RADIX_BITS;
+        forEachChunk([&](int t, size_t first, size_t last) {
+            counts[t].fill(0);
+            for (size_t i = first; i < last; i++) {
+                counts[t][(current[i].key >> shift) & (BUCKETS - 1)]++;
+            }
+        });
+
+        // Skip the pass if every key has the same digit here
+        size_t firstDigitCount = 0;
+        int usedDigits = 0;
+        for (int d = 0; d < BUCKETS; d++) {
+            size_t total = 0;
+            for (int t = 0; t < threadCount; t++) total += counts[t][d];
+            if (total) {
+                usedDigits++;
+                firstDigitCount = total;
+            }
+        }
+        if (usedDigits <= 1 && firstDigitCount == n) continue;
+
+        // Exclusive prefix sums: digit-major, then thread order (keeps it stable)
+        size_t offset = 0;
+        for (int d = 0; d < BUCKETS; d++) {
+            for (int t = 0; t < threadCount; t++) {
+                size_t count = counts[t][d];
+                counts[t][d] = offset;
+                offset += count;
+            }
+        }
+
+        forEachChunk([&](int t, size_t first, size_t last) {
+            array<size_t, BUCKETS>& position = counts[t];
+            for (size_t i = first; i < last; i++) {
+                next[position[(current[i].key >> shift) & (BUCKETS - 1)]++] = current[i];
+            }
+        });
+        current.swap(next);
+    }
+
+    order.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        order[i] = current[i].index;
+    }
+}
+
+// Case-insensitive (ASCII) hashing and comparison of team names, so lookups
+// need no lower-cased copy of the query
+struct FoldedNameHash {
+    size_t operator()(const string& name) const {
+        uint64_t hash = 1469598103934665603ULL;  // FNV-1a
+        for (unsigned char c : name) {
+            hash = (hash ^ tolower(c)) * 1099511628211ULL;
+        }
+        return hash;
+    }
+};
+
+struct FoldedNameEqual {
+    bool operator()(const string& a, const string& b) const {
+        return a.size() == b.size() &&
+               equal(a.begin(), a.end(), b.begin(), [](unsigned char x, unsigned char y) {
+                   return tolower(x) == tolower(y);
+               });
+    }
+};
+
+// Search index over the names of the teams in a championship: a
+// case-insensitive hash map for whole names, and sorted arrays of the
+// lower-cased names and of every later word in them for prefix lookups
+// ("univ", "cfr"). Single teams are inserted in place; bulk loads rebuild
+// with one sort.
+class TeamNameIndex {
+private:
+    struct WordEntry {
+        int32_t id;
+        int32_t offset;    // Start of the word in the folded name
+    };
+
+    unordered_map<string, int, FoldedNameHash, FoldedNameEqual> byName;  // name -> ID
+    vector<string> folded;     // ID -> lower-cased name ("" if not indexed)
+    vector<WordEntry> starts;  // First words, sorted by the folded name
+    vector<WordEntry> words;   // Later words, sorted by the folded name from the word on
+
+    string_view wordAt(const WordEntry& entry) const {
+        return string_view(folded[entry.id]).substr(entry.offset);
+    }
+
+    bool wordBefore(const WordEntry& a, const WordEntry& b) const {
+        string_view x = wordAt(a), y = wordAt(b);
+        return x != y ? x < y : a.id < b.id;
+    }
+
+    vector<WordEntry>& listFor(int32_t offset) {
+        return offset == 0 ? starts : words;
+    }
+
+    // Append IDs of entries starting with key, skipping ones already listed
+    void collect(const vector<WordEntry>& list, const string& key, size_t limit, vector<int>& ids) const {
+        auto it = lower_bound(list.begin(), list.end(), key,
+            [this](const WordEntry& entry, const string& value) { return wordAt(entry) < value; });
+        for (; it != list.end() && ids.size() < limit; ++it) {
+            if (wordAt(*it).compare(0, key.size(), key) != 0) break;
+            if (std::find(ids.begin(), ids.end(), it->id) == ids.end()) {
+                ids.push_back(it->id);
+            }
+        }
+    }
+
+    static string foldName(const string& name) {
+        string result(name);
+        for (char& c : result) {
+            c = tolower(static_cast<unsigned char>(c));
+        }
+        return result;
+    }
+
+    // Word starts: the first character and every letter or digit after a separator
+    template <typename Visit>
+    static void forEachWord(const string& name, Visit visit) {
+        for (size_t i = 0; i < name.size(); i++) {
+            bool start = i == 0 || !isalnum(static_cast<unsigned char>(name[i - 1]));
+            if (start && (i == 0 || isalnum(static_cast<unsigned char>(name[i])))) {
+                visit(static_cast<int32_t>(i));
+            }
+        }
+    }
+
+    void store(int id, const string& name) {
+        if (id >= static_cast<int>(folded.size())) {
+            folded.resize(id + 1);
+        }
+        folded[id] = foldName(name);
+        byName.emplace(name, id);
+    }
+
+public:
+    // Rebuild from (ID, name) pairs
+    void build(const vector<pair<int, string>>& entries) {
+        byName.clear();
+        folded.clear();
+        starts.clear();
+        words.clear();
+        byName.reserve(entries.size());
+        for (const pair<int, string>& entry : entries) {
+            store(entry.first, entry.second);
+            forEachWord(entry.second, [&](int32_t offset) { listFor(offset).push_back({entry.first, offset}); });
+        }
+        for (vector<WordEntry>* list : {&starts, &words}) {
+            sort(list->begin(), list->end(), [this](const WordEntry& a, const WordEntry& b) {
+                return wordBefore(a, b);
+            });
+        }
+    }
+
+    void add(int id, const string& name) {
+        store(id, name);
+        forEachWord(name, [&](int32_t offset) {
+            WordEntry entry = {id, offset};
+            vector<WordEntry>& list = listFor(offset);
+            list.insert(upper_bound(list.begin(), list.end(), entry,
+                [this](const WordEntry& a, const WordEntry& b) { return wordBefore(a, b); }), entry);
+        });
+    }
+
+    void remove(int id, const string& name) {
+        for (vector<WordEntry>* list : {&starts, &words}) {
+            list->erase(remove_if(list->begin(), list->end(),
+                [id](const WordEntry& entry) { return entry.id == id; }), list->end());
+        }
+        auto it = byName.find(name);
+        if (it != byName.end() && it->second == id) {
+            byName.erase(it);
+        }
+        string removed = move(folded[id]);
+        folded[id].clear();
+        // Another team whose name differs only in case takes over the key
+        for (size_t other = 0; other < folded.size(); other++) {
+            if (!removed.empty() && folded[other] == removed) {
+                byName.emplace(folded[other], other);
+                break;
+            }
+        }
+    }
+
+    // Team ID of a name compared case-insensitively (-1 if not indexed)
+    int find(const string& name) const {
+        auto it = byName.find(name);
+        return it != byName.end() ? it->second : -1;
+    }
+
+    // IDs of up to limit teams with a word starting with prefix
+    // (case-insensitive); names that start with it come first
+    vector<int> findPrefix(const string& prefix, size_t limit) const {
+        vector<int> ids;
+        string key = foldName(prefix);
+        if (!key.empty()) {
+            collect(starts, key, limit, ids);
+            collect(words, key, limit, ids);
+        }
+        return ids;
+    }
+};
+
+// ===== Standings rendering =====
+
+enum class StandingsFormat { TABLE, CSV, JSON };
+const char* const STANDINGS_FORMAT_NAMES[] = {"table", "csv", "json"};
+
+bool parseStandingsFormat(const string& text, StandingsFormat& format) {
+    for (int i = 0; i < static_cast<int>(size(STANDINGS_FORMAT_NAMES)); i++) {
+        if (text == STANDINGS_FORMAT_NAMES[i]) {
+            format = static_cast<StandingsFormat>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Format implied by a file name: .json and .txt (table), CSV otherwise
+StandingsFormat standingsFormatFor(const string& filename) {
+    string extension = filesystem::path(filename).extension().string();
+    for (char& c : extension) c = tolower(static_cast<unsigned char>(c));
+    if (extension == ".json") return StandingsFormat::JSON;
+    if (extension == ".txt") return StandingsFormat::TABLE;
+    return StandingsFormat::CSV;
+}
+
+// Text buffer that output is formatted into and then written in one call.
+// The buffer keeps its capacity between renders; copies start empty.
+class RenderBuffer {
+    string text;
+
+public:
+    RenderBuffer() {}
+    RenderBuffer(const RenderBuffer&) {}
+    RenderBuffer& operator=(const RenderBuffer&) { return *this; }
+
+    // Start a new render expected to take about bytes characters
+    void reset(size_t bytes) {
+        text.clear();
+        text.reserve(bytes);
+    }
+
+    const string& str() const { return text; }
+
+    void write(ostream& out) const { out.write(text.data(), text.size()); }
+
+    RenderBuffer& append(const string& s) { text += s; return *this; }
+    RenderBuffer& append(const char* s) { text += s; return *this; }
+    RenderBuffer& append(char c) { text += c; return *this; }
+    RenderBuffer& append(size_t count, char c) { text.append(count, c); return *this; }
+
+    RenderBuffer& append(long long value) {
+        char digits[24];
+        char* end = to_chars(digits, digits + sizeof(digits), value).ptr;
+        text.append(digits, end);
+        return *this;
+    }
+
+    // Left-aligned in a field of width characters, like << left << setw(width)
+    RenderBuffer& padded(const string& s, size_t width) {
+        text += s;
+        if (s.size() < width) text.append(width - s.size(), ' ');
+        return *this;
+    }
+
+    // Like padded(truncateString(s, width), width), without the temporary
+    RenderBuffer& truncated(const string& s, size_t width) {
+        if (s.size() <= width) return padded(s, width);
+        text.append(s, 0, width - 3);
+        text += "...";
+        return *this;
+    }
+
+    RenderBuffer& padded(long long value, size_t width) {
+        size_t start = text.size();
+        append(value);
+        size_t length = text.size() - start;
+        if (length < width) text.append(width - length, ' ');
+        return *this;
+    }
+
+    // CSV field, quoted only when it contains a separator, quote or newline
+    RenderBuffer& csvField(const string& s) {
+        if (s.find_first_of(",\"\r\n") == string::npos) {
+            text += s;
+            return *this;
+        }
+        text += '"';
+        for (char c : s) {
+            if (c == '"') text += '"';
+            text += c;
+        }
+        text += '"';
+        return *this;
+    }
+
+    // Quoted and escaped JSON string
+    RenderBuffer& jsonString(const string& s) {
+        static const char HEX[] = "0123456789abcdef";
+        text += '"';
+        for (char c : s) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                text += '\\';
+                text += c;
+            } else if (u < 0x20) {
+                text += "\\u00";
+                text += HEX[u >> 4];
+                text += HEX[u & 15];
+            } else {
+                text += c;
+            }
+        }
+        text += '"';
+        return *this;
+    }
+};
+
+// Championship class managing the entire league
+class Championship {
+private:
+    // Team, name and fixture data are copy-on-write so forks share them until
+    // they diverge; statistics and the ranking are copied with every fork.
+    string name;
+    Cow<vector<Team>> teams; // Name, value and ID; statistics live in stats
+    TeamStatsBlock stats;    // Indexed like teams
+    FixtureSchedule fixtures;
+    int stagesCompleted;
+    int totalStages;
+    uint64_t seed;
+
+    // Interned team names: IDs are dense and never reused, so fixtures keep
+    // resolving after a team is relegated
+    Cow<vector<string>> teamNames;           // ID -> name
+    Cow<unordered_map<string, int>> teamIds; // name -> ID
+    Cow<vector<int>> indexById;              // ID -> index in teams (-1 if not in the league)
+    Cow<TeamNameIndex> nameIndex;            // Search index over the teams in the league
+
+    // Times each stage has been played (empty until the first play); the
+    // next play of a stage draws from the attempt after its count
+    Cow<vector<uint32_t>> stagePlays;
+
+    // Ranking index kept in standings order as results are applied
+    vector<int> ranking;                // position -> team index
+    vector<int> rankOf;                 // team index -> position (0-based)
+
+    // Tie-break rules after points, and the head-to-head results they need
+    // (empty unless the rules use head-to-head criteria)
+    TieBreakRules tieBreaks;
+    HeadToHeadMatrix headToHead;        // Indexed like teams
+
+    // Scratch buffers reused by playStage (not part of the championship state,
+    // so copies start with empty ones)
+    struct StageScratch {
+        StageBatch batch;
+        StageSample sample;
+        FlowNetwork flow;                       // Title race network
+        vector<pair<int, int>> remaining;       // Unplayed matches (team indices)
+        vector<int> remainingCount;             // Unplayed matches per team
+        vector<int> flowNode;                   // Team index -> network node
+        vector<int> flowRoom;                   // Points a team may still take
+        TieBreakScratch tieBreak;
+        vector<uint8_t> outcome;                // Team index -> result in the stage
+        StageScratch() {}
+        StageScratch(const StageScratch&) {}
+        StageScratch& operator=(const StageScratch&) { return *this; }
+    } scratch;
+    mutable RenderBuffer render;        // Reused by the standings renderer
+
+    // Undo history: the first historyPosition deltas are applied, the rest
+    // can be redone. Cleared whenever the teams or fixtures change shape, so
+    // team indices resolved from fixtures stay valid for every delta. Forks
+    // start with an empty history.
+    Cow<deque<StageDelta>> history;
+    size_t historyPosition;
+    size_t historyResults;              // Results held by all deltas
+
+    // Standings after each played stage, for historical queries
+    StandingsHistory standingsHistory;
+
+    // Start recording a stage play: drop the redo tail, make room within
+    // the history limits (reusing the buffers of a dropped delta) and
+    // capture the stage as it is now
+    StageDelta beginStageDelta(int stage) {
+        deque<StageDelta>& entries = history.mut();
+        while (entries.size() > historyPosition) {
+            historyResults -= entries.back().resultCount();
+            entries.pop_back();
+        }
+        StageDelta delta;
+        size_t incoming = 2 * fixtures.matchCount(stage);
+        while (!entries.empty() && (entries.size() >= HISTORY_MAX_STAGES ||
+                                    historyResults + incoming > HISTORY_MAX_RESULTS)) {
+            historyResults -= entries.front().resultCount();
+            delta = move(entries.front());
+            entries.pop_front();
+            historyPosition--;
+        }
+        delta.stage = stage;
+        delta.completedBefore = stagesCompleted;
+        delta.replay = fixtures.stagePlayed(stage);
+        fixtures.copyResults(stage, delta.before);
+        return delta;
+    }
+
+    // Finish recording a stage play
+    void commitStageDelta(StageDelta&& delta) {
+        delta.completedAfter = stagesCompleted;
+        fixtures.copyResults(delta.stage, delta.after);
+        historyResults += delta.resultCount();
+        history.mut().push_back(move(delta));
+        historyPosition = history.size();
+    }
+
+    void clearHistory() {
+        history = Cow<deque<StageDelta>>();
+        historyPosition = 0;
+        historyResults = 0;
+    }
+
+    // Attempt number the next play of a stage draws from. Stages played
+    // before plays were counted (older data files) count as played once.
+    uint32_t nextAttempt(int stage) const {
+        uint32_t plays = stage < static_cast<int>(stagePlays.size()) ? stagePlays[stage] : 0;
+        return max(plays, fixtures.stagePlayed(stage) ? 1u : 0u);
+    }
+
+    void setStagePlays(int stage, uint32_t plays) {
+        vector<uint32_t>& counts = stagePlays.mut();
+        if (static_cast<int>(counts.size()) < fixtures.stageCount()) {
+            counts.resize(fixtures.stageCount(), 0);
+        }
+        counts[stage] = plays;
+    }
+
+    // Start an empty standings history (the teams or fixtures changed shape)
+    void clearStandingsHistory() {
+        standingsHistory.reset(teams.size(), fixtures.stageCount());
+    }
+
+    // Record the standings as they are after playing stage
+    void recordStandings(int stage) {
+        if (!standingsHistory.enabled()) return;
+        vector<uint8_t>& stageOutcome = scratch.outcome;
+        stageOutcome.assign(teams.size(), StandingsHistory::NONE);
+        for (int slot = 0; slot < fixtures.matchCount(stage); slot++) {
+            Match match = fixtures.at(stage, slot);
+            int homeIndex = teamIndex(match.homeId);
+            int awayIndex = teamIndex(match.awayId);
+            if (!match.played || homeIndex == -1 || awayIndex == -1) continue;
+            
+            int sign = (match.homeGoals > match.awayGoals) - (match.homeGoals < match.awayGoals);
+            stageOutcome[homeIndex] = sign > 0 ? StandingsHistory::WIN : sign < 0 ? StandingsHistory::LOSS
+                                                                                 : StandingsHistory::DRAW;
+            stageOutcome[awayIndex] = sign < 0 ? StandingsHistory::WIN : sign > 0 ? StandingsHistory::LOSS
+                                                                                 : StandingsHistory::DRAW;
+        }
+        standingsHistory.record(stage, rankOf, stats.points, stageOutcome);
+    }
+
+    // Get the ID for a team name, interning it if it is new
+    int internTeam(const string& teamName) {
+        auto it = teamIds.find(teamName);
+        if (it != teamIds.end()) {
+            return it->second;
+        }
+        int id = teamNames.size();
+        teamNames.mut().push_back(teamName);
+        teamIds.mut().emplace(teamName, id);
+        indexById.mut().push_back(-1);
+        return id;
+    }
+
+    // Rebuild ID -> index mapping after the team list changed shape
+    void rebuildTeamIndex() {
+        vector<int>& index = indexById.mut();
+        fill(index.begin(), index.end(), -1);
+        for (size_t i = 0; i < teams.size(); i++) {
+            index[teams[i].id] = i;
+        }
+    }
+
+    // Helper function to find team index (exact name first, then ignoring case)
+    int findTeamIndex(const string& teamName) const {
+        auto it = teamIds.find(teamName);
+        if (it != teamIds.end() && indexById[it->second] != -1) {
+            return indexById[it->second];
+        }
+        return teamIndex(nameIndex->find(teamName));
+    }
+
+    // Index the names of every team in the league at once
+    void rebuildNameIndex() {
+        vector<pair<int, string>> entries;
+        entries.reserve(teams.size());
+        for (const Team& team : teams) {
+            entries.emplace_back(team.id, team.name);
+        }
+        nameIndex.mut().build(entries);
+    }
+
+    // Helper function to find team index by ID
+    int teamIndex(int id) const {
+        return id >= 0 && id < static_cast<int>(indexById.size()) ? indexById[id] : -1;
+    }
+
+    // Apply (sign = +1) or remove (sign = -1) one result in the raw counters
+    // and the head-to-head matrix; call recomputeStandings() afterwards
+    void addResult(int homeIndex, int awayIndex, int homeGoals, int awayGoals, int sign) {
+        stats.addResult(homeIndex, awayIndex, homeGoals, awayGoals, sign);
+        if (!headToHead.empty()) {
+            headToHead.addResult(homeIndex, awayIndex, homeGoals, awayGoals, sign);
+        }
+    }
+
+    // Rebuild the head-to-head matrix from the played fixtures (after the
+    // team list, fixtures or rules changed); dropped when not needed
+    void rebuildHeadToHead() {
+        int n = teams.size();
+        if (!tieBreaks.usesHeadToHead() || n > HEAD_TO_HEAD_MAX_TEAMS) {
+            headToHead.clear();
+            return;
+        }
+        headToHead.reset(n);
+        for (int stage = 0; stage < fixtures.stageCount(); stage++) {
+            if (!fixtures.hasResults(stage)) continue;
+            for (int slot = 0; slot < fixtures.matchCount(stage); slot++) {
+                Match match = fixtures.at(stage, slot);
+                int homeIndex = teamIndex(match.homeId);
+                int awayIndex = teamIndex(match.awayId);
+                if (match.played && homeIndex != -1 && awayIndex != -1) {
+                    headToHead.addResult(homeIndex, awayIndex, match.homeGoals, match.awayGoals, +1);
+                }
+            }
+        }
+    }
+
+    // Rebuild the head-to-head matrix, then re-rank if the rules use it
+    void refreshHeadToHeadRanking() {
+        rebuildHeadToHead();
+        if (!headToHead.empty()) {
+            rebuildRanking();
+        }
+    }
+
+    // Re-order teams level on points by the tie-break rules (nothing to do
+    // for the standard rules, which the ranking key already encodes)
+    void resolveTiedGroups() {
+        if (tieBreaks.isStandard()) return;
+        tieBreaks.resolve(ranking,
+            [this](int t) { return stats.points[t]; },
+            [this](int t) { return stats.goalDifference[t]; },
+            [this](int t) { return stats.goalsFor[t]; },
+            headToHead, scratch.tieBreak);
+        for (size_t pos = 0; pos < ranking.size(); pos++) {
+            rankOf[ranking[pos]] = pos;
+        }
+    }
+
+    // Append a team without touching the ranking; fails on duplicates
+    bool appendTeam(Team team) {
+        team.id = internTeam(team.name);
+        if (indexById[team.id] != -1) {
+            return false;
+        }
+        indexById.mut()[team.id] = teams.size();
+        stats.push(team);
+        team.resetStats();
+        teams.mut().push_back(team);
+        clearHistory();
+        clearStandingsHistory();
+        return true;
+    }
+
+    // Append a team, interning its name; fails if the league already has a
+    // team of that name, ignoring case
+    bool insertTeam(const Team& team) {
+        if (findTeamIndex(team.name) != -1 || !appendTeam(team)) {
+            return false;
+        }
+        nameIndex.mut().add(teams->back().id, team.name);
+        if (!headToHead.empty() || tieBreaks.usesHeadToHead()) {
+            rebuildHeadToHead();
+        }
+        insertIntoRanking(teams.size() - 1);
+        return true;
+    }
+
+    // Team with its current statistics filled in (for display)
+    Team teamView(int index) const {
+        Team view = teams[index];
+        stats.copyTo(index, view);
+        return view;
+    }
+
+    // Standings order: points, goal difference, goals for, then registration order
+    bool ranksAbove(int a, int b) const {
+        if (stats.sortKey[a] != stats.sortKey[b]) {
+            return stats.sortKey[a] > stats.sortKey[b];
+        }
+        return a < b;
+    }
+
+    // Fully re-sort the ranking index (team list changed shape or bulk update)
+    void rebuildRanking() {
+        if (teams.size() >= RADIX_MIN_TEAMS) {
+            radixRankByKey(stats.sortKey, ranking);
+        } else {
+            ranking.resize(teams.size());
+            iota(ranking.begin(), ranking.end(), 0);
+            sort(ranking.begin(), ranking.end(), [this](int a, int b) { return ranksAbove(a, b); });
+        }
+        rankOf.assign(teams.size(), 0);
+        for (size_t pos = 0; pos < ranking.size(); pos++) {
+            rankOf[ranking[pos]] = pos;
+        }
+        resolveTiedGroups();
+    }
+
+    // Binary-search insert a newly added team into the ranking index. With
+    // custom tie-breaks the order is only sorted by points, so the search
+    // lands inside the team's points group, which is then re-resolved.
+    void insertIntoRanking(int team) {
+        auto it = lower_bound(ranking.begin(), ranking.end(), team,
+            [this](int a, int b) { return ranksAbove(a, b); });
+        int pos = it - ranking.begin();
+        ranking.insert(it, team);
+        rankOf.push_back(0);
+        for (int p = pos; p < static_cast<int>(ranking.size()); p++) {
+            rankOf[ranking[p]] = p;
+        }
+        resolveTiedGroups();
+    }
+
+public:
+    Championship(string name = "") 
+        : name(name), stagesCompleted(0), totalStages(0), seed(MatchRng::randomSeed()),
+          historyPosition(0), historyResults(0) {}
+
+    // Branch this championship into a what-if scenario. The fork shares team
+    // names, values, fixtures and stored results with this championship until
+    // either side changes them; statistics and the ranking are copied and
+    // the undo history starts empty. The seed is kept, so a fork plays the
+    // same results as the original until the two states differ.
+    Championship fork(const string& forkName) const {
+        Championship copy(*this);
+        copy.name = forkName;
+        copy.clearHistory();
+        return copy;
+    }
+
+    // Whether the team list and a stage's results are still shared with a fork
+    bool sharesTeamsWith(const Championship& other) const { return teams.sharesWith(other.teams); }
+    bool sharesStageWith(const Championship& other, int stage) const {
+        return fixtures.sharesResults(other.fixtures, stage);
+    }
+
+    // Add a new team to the championship
+    void addTeam(const Team& team) {
+        insertTeam(team);
+    }
+
+    // Add many teams at once, ranking them with a single sort
+    void addTeams(const vector<Team>& newTeams) {
+        teams.mut().reserve(teams.size() + newTeams.size());
+        stats.reserve(teams.size() + newTeams.size());
+        for (const Team& team : newTeams) {
+            appendTeam(team);
+        }
+        rebuildNameIndex();
+        rebuildHeadToHead();
+        rebuildRanking();
+    }
+
+    // Recompute derived statistics and the full standings order from scratch
+    void recomputeStandings() {
+        stats.refreshAll();
+        rebuildRanking();
+    }
+
+    // Remove a team (relegation)
+    bool relegateTeam(const string& teamName) {
+        int index = findTeamIndex(teamName);
+        if (index != -1) {
+            nameIndex.mut().remove(teams[index].id, teams[index].name);
+            teams.mut().erase(teams->begin() + index);
+            stats.erase(index);
+            rebuildTeamIndex();
+            rebuildHeadToHead();
+            rebuildRanking();
+            clearHistory();
+            clearStandingsHistory();
+            cout << teamName << " relegated successfully.\n";
+            return true;
+        }
+        cout << "Team not found!\n";
+        return false;
+    }
+
+    // Add a new team (promotion)
+    bool promoteTeam(const Team& team) {
+        if (!insertTeam(team)) {
+            cout << team.name << " is already in the championship!\n";
+            return false;
+        }
+        cout << team.name << " promoted successfully.\n";
+        return true;
+    }
+
+    // Team IDs in registration order (the circle-method roster)
+    vector<int> rosterIds() const {
+        vector<int> ids;
+        ids.reserve(teams.size());
+        for (const Team& team : teams) {
+            ids.push_back(team.id);
+        }
+        return ids;
+    }
+
+    // Generate fixtures using round-robin algorithm
+    void generateFixtures() {
+        fixtures.clear();
+        stagePlays = Cow<vector<uint32_t>>();
+        clearHistory();
+        clearStandingsHistory();
+        if (teams.size() < 2) {
+            cout << "Not enough teams to generate fixtures!\n";
+            return;
+        }
+
+        fixtures.generate(rosterIds());
+        totalStages = fixtures.stageCount();
+        clearStandingsHistory();
+        if (!headToHead.empty()) {
+            refreshHeadToHeadRanking();
+        }
+        
+        cout << "Generated " << totalStages << " stages with " 
+             << fixtures.matchCount(0) << " matches per stage\n";
+    }
+
+    // Display fixtures for a specific stage
+    void displayFixtures(int stage, ostream& out = cout) const {
+        if (stage < 0 || stage >= fixtures.stageCount()) {
+            out << "Invalid stage number!\n";
+            return;
+        }
+
+        out << "\n--- " << name << " Stage " << stage + 1 << " Fixtures ---\n";
+        for (int slot = 0; slot < fixtures.matchCount(stage); slot++) {
+            Match match = fixtures.at(stage, slot);
+            out << teamNames[match.homeId] << " vs " << teamNames[match.awayId];
+            if (match.played) {
+                out << " : " << match.homeGoals << "-" << match.awayGoals;
+            }
+            out << endl;
+        }
+    }
+
+    // Simulate a stage without printing (false if the stage does not exist).
+    // Only this championship's state is touched, so different championships
+    // can be simulated from different threads at once.
+    bool simulateStage(int stage) {
+        if (stage < 0 || stage >= fixtures.stageCount()) {
+            return false;
+        }
+        uint32_t attempt = nextAttempt(stage);
+        StageDelta delta = beginStageDelta(stage);
+
+        // Reverse previous results if already played
+        bool replay = delta.replay;
+        StageBatch& batch = scratch.batch;
+        batch.clear();
+        int matchCount = fixtures.matchCount(stage);
+        for (int m = 0; m < matchCount; m++) {
+            Match match = fixtures.at(stage, m);
+            int homeIndex = teamIndex(match.homeId);
+            int awayIndex = teamIndex(match.awayId);
+            if (homeIndex == -1 || awayIndex == -1) continue;
+            
+            if (replay) {
+                addResult(homeIndex, awayIndex, match.homeGoals, match.awayGoals, -1);
+            }
+            batch.add(homeIndex, awayIndex, m, teams[homeIndex].value, teams[awayIndex].value);
+        }
+
+        // Sample every score of the stage in one batch (goals 0-5)
+        StageSample& sample = scratch.sample;
+        sample.run(batch, MatchRng::streamKey(seed, 0, stage, attempt));
+
+        // Scatter results into the statistics, then re-rank once
+        for (size_t i = 0; i < batch.size(); i++) {
+            fixtures.setResult(stage, batch.slot[i], sample.homeGoals[i], sample.awayGoals[i]);
+            addResult(batch.home[i], batch.away[i], sample.homeGoals[i], sample.awayGoals[i], +1);
+        }
+        recomputeStandings();
+        recordStandings(stage);
+        setStagePlays(stage, attempt + 1);
+        
+        stagesCompleted = stage + 1;
+        commitStageDelta(move(delta));
+        return true;
+    }
+
+    // Play a specific stage (standings are printed unless running headless)
+    bool playStage(int stage, bool showStandings = true) {
+        if (!simulateStage(stage)) {
+            cout << "Invalid stage number!\n";
+            return false;
+        }
+        cout << "Stage " << stage + 1 << " completed!\n";
+        if (showStandings) {
+            displayStandings();
+        }
+        return true;
+    }
+
+    // Stored result of every fixture of a stage
+    vector<MatchResult> getStageResults(int stage) const {
+        vector<MatchResult> results;
+        for (int slot = 0; slot < fixtures.matchCount(stage); slot++) {
+            Match match = fixtures.at(stage, slot);
+            results.push_back({static_cast<uint8_t>(match.homeGoals), static_cast<uint8_t>(match.awayGoals),
+                               static_cast<uint8_t>(match.played)});
+        }
+        return results;
+    }
+
+    // Re-apply results recorded by getStageResults, with the same effect as
+    // the simulateStage call that produced them (false if they do not fit).
+    // plays is the stage's play count after that call (0: one more play).
+    bool applyStageResults(int stage, const vector<MatchResult>& results, uint32_t plays = 0) {
+        if (stage < 0 || stage >= fixtures.stageCount() ||
+            static_cast<int>(results.size()) != fixtures.matchCount(stage)) {
+            return false;
+        }
+        if (plays == 0) {
+            plays = nextAttempt(stage) + 1;
+        }
+        StageDelta delta = beginStageDelta(stage);
+        bool replay = delta.replay;
+        for (size_t slot = 0; slot < results.size(); slot++) {
+            Match match = fixtures.at(stage, slot);
+            int homeIndex = teamIndex(match.homeId);
+            int awayIndex = teamIndex(match.awayId);
+            if (homeIndex == -1 || awayIndex == -1) continue;
+            
+            if (replay) {
+                addResult(homeIndex, awayIndex, match.homeGoals, match.awayGoals, -1);
+            }
+            const MatchResult& result = results[slot];
+            fixtures.setResult(stage, slot, result.homeGoals, result.awayGoals, result.played);
+            addResult(homeIndex, awayIndex, result.homeGoals, result.awayGoals, +1);
+        }
+        recomputeStandings();
+        recordStandings(stage);
+        setStagePlays(stage, plays);
+        stagesCompleted = stage + 1;
+        commitStageDelta(move(delta));
+        return true;
+    }
+
+    // Apply a stage delta backwards (undo) or forwards (redo). Only the
+    // stage's own matches are touched (false if the delta does not fit).
+    bool applyStageDelta(const StageDelta& delta, bool undo) {
+        int matchCount = delta.stage >= 0 && delta.stage < fixtures.stageCount()
+                       ? fixtures.matchCount(delta.stage) : -1;
+        if (matchCount < 0 || static_cast<int>(delta.after.size()) != matchCount ||
+            (!delta.before.empty() && static_cast<int>(delta.before.size()) != matchCount) ||
+            (delta.replay && delta.before.empty())) {
+            return false;
+        }
+        const vector<MatchResult>& current = undo ? delta.after : delta.before;
+        const vector<MatchResult>& target = undo ? delta.before : delta.after;
+        bool removeCurrent = undo || delta.replay;
+        bool addTarget = !undo || delta.replay;
+        for (int slot = 0; slot < matchCount; slot++) {
+            pair<int, int> ids = fixtures.teamsAt(delta.stage, slot);
+            int homeIndex = teamIndex(ids.first);
+            int awayIndex = teamIndex(ids.second);
+            if (homeIndex == -1 || awayIndex == -1) continue;
+            
+            if (removeCurrent) {
+                addResult(homeIndex, awayIndex, current[slot].homeGoals, current[slot].awayGoals, -1);
+            }
+            if (addTarget) {
+                addResult(homeIndex, awayIndex, target[slot].homeGoals, target[slot].awayGoals, +1);
+            }
+        }
+        fixtures.setStageResults(delta.stage, target);
+        recomputeStandings();
+        if (undo) {
+            standingsHistory.forgetFrom(delta.stage);
+        } else {
+            recordStandings(delta.stage);
+        }
+        stagesCompleted = undo ? delta.completedBefore : delta.completedAfter;
+        return true;
+    }
+
+    // Delta that undoStage/redoStage would apply next (null if none)
+    const StageDelta* nextUndo() const {
+        return historyPosition > 0 ? &history[historyPosition - 1] : nullptr;
+    }
+    const StageDelta* nextRedo() const {
+        return historyPosition < history.size() ? &history[historyPosition] : nullptr;
+    }
+
+    // Undo the most recent stage play
+    bool undoStage() {
+        if (!nextUndo()) return false;
+        applyStageDelta(history[historyPosition - 1], true);
+        historyPosition--;
+        return true;
+    }
+
+    // Redo the most recently undone stage play
+    bool redoStage() {
+        if (!nextRedo()) return false;
+        applyStageDelta(history[historyPosition], false);
+        historyPosition++;
+        return true;
+    }
+
+    // Apply a delta that did not come from this history (journal replay).
+    // If it matches the next undo or redo step that step is taken, so the
+    // history survives; otherwise the history no longer describes how the
+    // state was reached and is dropped.
+    bool applyExternalDelta(const StageDelta& delta, bool undo) {
+        const StageDelta* next = undo ? nextUndo() : nextRedo();
+        if (next && *next == delta) {
+            return undo ? undoStage() : redoStage();
+        }
+        if (!applyStageDelta(delta, undo)) return false;
+        clearHistory();
+        return true;
+    }
+
+    // Undo/redo steps that lead to the state with `completed` stages played:
+    // negative to undo, positive to redo. The nearest such state at or
+    // before the current one wins, then the nearest after it. Returns false
+    // if no state in the history has that many stages completed.
+    bool stepsToStage(int completed, int& steps) const {
+        auto completedAt = [&](size_t position) {
+            return position == 0 ? history.empty() ? stagesCompleted : history[0].completedBefore
+                                 : history[position - 1].completedAfter;
+        };
+        for (size_t p = historyPosition + 1; p-- > 0;) {
+            if (completedAt(p) == completed) {
+                steps = static_cast<int>(p) - static_cast<int>(historyPosition);
+                return true;
+            }
+        }
+        for (size_t p = historyPosition + 1; p <= history.size(); p++) {
+            if (completedAt(p) == completed) {
+                steps = static_cast<int>(p - historyPosition);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int getUndoCount() const { return historyPosition; }
+    int getRedoCount() const { return history.size() - historyPosition; }
+
+    // Matches and goals of a stage's stored results
+    int getStageMatchesPlayed(int stage) const {
+        int played = 0;
+        if (stage >= 0 && stage < fixtures.stageCount() && fixtures.hasResults(stage)) {
+            for (int slot = 0; slot < fixtures.matchCount(stage); slot++) {
+                played += fixtures.at(stage, slot).played;
+            }
+        }
+        return played;
+    }
+
+    int getStageGoals(int stage) const {
+        int goals = 0;
+        if (stage >= 0 && stage < fixtures.stageCount() && fixtures.hasResults(stage)) {
+            for (int slot = 0; slot < fixtures.matchCount(stage); slot++) {
+                Match match = fixtures.at(stage, slot);
+                goals += match.homeGoals + match.awayGoals;
+            }
+        }
+        return goals;
+    }
+
+    // Team at a standings position (0-based)
+    Team getTeamAtPosition(int position) const {
+        return teamView(ranking[position]);
+    }
+
+    // Simulate many independent seasons in parallel and collect final positions.
+    // Already played matches are kept; every unplayed fixture is simulated, so
+    // this works both before the season and mid-season. The live teams and
+    // fixtures are never modified. Final positions use the tie-break rules;
+    // each worker copies the head-to-head matrix once and removes a season's
+    // simulated results again after ranking it. Leagues above
+    // SIMULATION_MAX_TEAMS return an empty result.
+    SimulationResult simulateSeasons(int seasons, int threadCount = 0) const {
+        SimulationResult result;
+        int n = teams.size();
+        result.teamCount = n;
+        if (n < 2 || n > SIMULATION_MAX_TEAMS || seasons <= 0) {
+            return result;
+        }
+
+        // Use the live schedule (or compute one if no fixtures were generated yet)
+        FixtureSchedule generated;
+        if (fixtures.empty()) {
+            generated.generate(rosterIds());
+        }
+        const FixtureSchedule& schedule = fixtures.empty() ? generated : fixtures;
+
+        // Resolve teams and rates once into per-stage batches shared by all workers
+        vector<StageBatch> pending;
+        vector<int> pendingStage;
+        for (int stage = 0; stage < schedule.stageCount(); stage++) {
+            StageBatch batch;
+            int matchCount = schedule.matchCount(stage);
+            for (int slot = 0; slot < matchCount; slot++) {
+                Match match = schedule.at(stage, slot);
+                if (match.played) continue;
+                int homeIndex = teamIndex(match.homeId);
+                int awayIndex = teamIndex(match.awayId);
+                if (homeIndex != -1 && awayIndex != -1) {
+                    batch.add(homeIndex, awayIndex, slot, teams[homeIndex].value, teams[awayIndex].value);
+                }
+            }
+            if (batch.size() > 0) {
+                pending.push_back(batch);
+                pendingStage.push_back(stage);
+            }
+        }
+
+        struct SimStats { int points; int goalsFor; int goalsAgainst; };
+        vector<SimStats> base(n);
+        for (int i = 0; i < n; i++) {
+            base[i] = {stats.points[i], stats.goalsFor[i], stats.goalsAgainst[i]};
+            result.teamNames.push_back(teams[i].name);
+        }
+
+        if (threadCount <= 0) {
+            threadCount = max(1u, thread::hardware_concurrency());
+        }
+        threadCount = min(threadCount, seasons);
+
+        // Per-thread state: stats buffer and the finishing orders of the last
+        // few seasons, which are added to the shared position table under a
+        // lock. Season s draws from its own RNG streams, so results do not
+        // depend on the number of threads.
+        result.positionCounts.assign(static_cast<size_t>(n) * n, 0);
+        mutex positionCountsMutex;
+        vector<vector<long long>> pointTotals(threadCount, vector<long long>(n, 0));
+        bool customTieBreaks = !tieBreaks.isStandard();
+
+        auto worker = [&](int t) {
+            vector<SimStats> stats;
+            StageSample sample;
+            vector<int> order(n);
+            HeadToHeadMatrix matrix;
+            TieBreakScratch tieBreakScratch;
+            vector<int> finishes;
+            finishes.reserve(static_cast<size_t>(SIMULATION_MERGE_SEASONS) * n);
+            if (customTieBreaks) {
+                matrix = headToHead;
+            }
+            vector<int> seasonGoals;
+            auto mergeFinishes = [&]() {
+                lock_guard<mutex> lock(positionCountsMutex);
+                for (size_t i = 0; i < finishes.size(); i++) {
+                    result.positionCounts[static_cast<size_t>(finishes[i]) * n + i % n]++;
+                }
+                finishes.clear();
+            };
+            int firstSeason = static_cast<long long>(seasons) * t / threadCount;
+            int lastSeason = static_cast<long long>(seasons) * (t + 1) / threadCount;
+
+            for (int season = firstSeason; season < lastSeason; season++) {
+                stats = base;
+                seasonGoals.clear();
+                for (size_t b = 0; b < pending.size(); b++) {
+                    const StageBatch& batch = pending[b];
+                    sample.run(batch, MatchRng::streamKey(seed, season + 1, pendingStage[b]));
+                    for (size_t i = 0; i < batch.size(); i++) {
+                        int homeGoals = sample.homeGoals[i];
+                        int awayGoals = sample.awayGoals[i];
+                        SimStats& home = stats[batch.home[i]];
+                        SimStats& away = stats[batch.away[i]];
+                        if (!matrix.empty()) {
+                            matrix.addResult(batch.home[i], batch.away[i], homeGoals, awayGoals, +1);
+                            seasonGoals.push_back(homeGoals);
+                            seasonGoals.push_back(awayGoals);
+                        }
+                        home.goalsFor += homeGoals;
+                        home.goalsAgainst += awayGoals;
+                        away.goalsFor += awayGoals;
+                        away.goalsAgainst += homeGoals;
+                        if (homeGoals > awayGoals) {
+                            home.points += 3;
+                        } else if (homeGoals < awayGoals) {
+                            away.points += 3;
+                        } else {
+                            home.points++;
+                            away.points++;
+                        }
+                    }
+                }
+
+                iota(order.begin(), order.end(), 0);
+                sort(order.begin(), order.end(), [&](int a, int b) {
+                    const SimStats& x = stats[a];
+                    const SimStats& y = stats[b];
+                    if (x.points != y.points) return x.points > y.points;
+                    int gdX = x.goalsFor - x.goalsAgainst;
+                    int gdY = y.goalsFor - y.goalsAgainst;
+                    if (gdX != gdY) return gdX > gdY;
+                    return x.goalsFor > y.goalsFor;
+                });
+                if (customTieBreaks) {
+                    tieBreaks.resolve(order,
+                        [&](int team) { return stats[team].points; },
+                        [&](int team) { return stats[team].goalsFor - stats[team].goalsAgainst; },
+                        [&](int team) { return stats[team].goalsFor; },
+                        matrix, tieBreakScratch);
+                }
+                if (!matrix.empty()) {
+                    // Undo only this season's simulated matches instead of
+                    // copying the whole matrix again for the next season
+                    size_t g = 0;
+                    for (const StageBatch& batch : pending) {
+                        for (size_t i = 0; i < batch.size(); i++, g += 2) {
+                            matrix.addResult(batch.home[i], batch.away[i], seasonGoals[g], seasonGoals[g + 1], -1);
+                        }
+                    }
+                }
+                for (int pos = 0; pos < n; pos++) {
+                    pointTotals[t][order[pos]] += stats[order[pos]].points;
+                }
+                finishes.insert(finishes.end(), order.begin(), order.end());
+                if (finishes.size() >= static_cast<size_t>(SIMULATION_MERGE_SEASONS) * n) {
+                    mergeFinishes();
+                }
+            }
+            mergeFinishes();
+        };
+
+        vector<thread> workers;
+        for (int t = 1; t < threadCount; t++) {
+            workers.emplace_back(worker, t);
+        }
+        worker(0);
+        for (thread& w : workers) {
+            w.join();
+        }
+
+        // Merge per-thread point totals (summed exactly before dividing, so the
+        // averages do not depend on the number of threads either)
+        result.seasons = seasons;
+        result.averagePoints.assign(n, 0.0);
+        for (int i = 0; i < n; i++) {
+            long long total = 0;
+            for (int t = 0; t < threadCount; t++) {
+                total += pointTotals[t][i];
+            }
+            result.averagePoints[i] = static_cast<double>(total) / seasons;
+        }
+        return result;
+    }
+
+    // Display title, European and relegation probabilities from a simulation
+    void displaySimulationReport(const SimulationResult& result,
+                                 int europeanSpots = 3, int relegationSpots = 3) const {
+        if (result.seasons == 0) {
+            cout << "No simulation results to display!\n";
+            return;
+        }
+
+        int n = result.teamCount;
+        vector<int> order(n);
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](int a, int b) {
+            return result.averagePoints[a] > result.averagePoints[b];
+        });
+
+        const int nameWidth = 50;
+        cout << "\n--- " << name << " Season Simulation (" << result.seasons << " seasons) ---\n";
+        cout << left << setw(nameWidth) << "Team"
+             << setw(10) << "Avg Pts"
+             << setw(10) << "Title %"
+             << setw(10) << "Europe %"
+             << "Releg %\n";
+        cout << string(nameWidth + 40, '-') << endl;
+
+        cout << fixed << setprecision(1);
+        for (int team : order) {
+            cout << left << setw(nameWidth) << truncateString(result.teamNames[team], nameWidth)
+                 << setw(10) << result.averagePoints[team]
+                 << setw(10) << result.probability(team, 0) * 100
+                 << setw(10) << result.rangeProbability(team, 0, europeanSpots) * 100
+                 << result.rangeProbability(team, n - relegationSpots, n) * 100 << endl;
+        }
+        cout.unsetf(ios::fixed);
+        cout << setprecision(6);
+    }
+
+    // Whether team x can still finish level with or above every other team
+    // when it wins all its remaining matches. Each remaining match between two
+    // other teams hands out at least 2 points (a draw); if those points cannot
+    // be routed so that nobody passes x's maximum, x is out of the title race.
+    // Teams that stay below x's maximum even taking 2 points from every match
+    // absorb their matches and are left out of the network. The points are
+    // first shared out greedily (a draw where both teams have room); the
+    // network is only built, starting from that flow, when the greedy pass
+    // could not place every point.
+    bool titleStillPossible(int x, const vector<int>& maxPoints) {
+        int n = teams.size();
+        int limit = maxPoints[x];
+        vector<int>& node = scratch.flowNode;
+        vector<int>& room = scratch.flowRoom;
+        node.assign(n, -1);
+        for (int j = 0; j < n; j++) {
+            if (j != x && stats.points[j] > limit) return false;
+        }
+        FlowNetwork& flow = scratch.flow;
+        const int source = 0, sink = 1;
+        long long needed = 0, placed = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            bool build = pass == 1;
+            if (build) flow.reset(2);
+            room.assign(n, 0);
+            for (int j = 0; j < n; j++) {
+                if (j == x) continue;
+                room[j] = limit - stats.points[j];
+                if (2 * scratch.remainingCount[j] > room[j]) {
+                    node[j] = build ? flow.addNode() : n;
+                }
+            }
+            needed = placed = 0;
+            for (const pair<int, int>& match : scratch.remaining) {
+                int home = match.first, away = match.second;
+                if (node[home] == -1 || node[away] == -1) continue;
+                int toHome = min(1, room[home]);
+                int toAway = min(1, room[away]);
+                int extra = 2 - toHome - toAway;
+                int moreHome = min(extra, room[home] - toHome);
+                toHome += moreHome;
+                toAway += min(extra - moreHome, room[away] - toAway);
+                room[home] -= toHome;
+                room[away] -= toAway;
+                needed += 2;
+                placed += toHome + toAway;
+                
+                if (build) {
+                    int matchNode = flow.addNode();
+                    flow.addEdge(source, matchNode, 2, toHome + toAway);
+                    flow.addEdge(matchNode, node[home], 2, toHome);
+                    flow.addEdge(matchNode, node[away], 2, toAway);
+                }
+            }
+            if (placed == needed) return true;
+        }
+        for (int j = 0; j < n; j++) {
+            if (node[j] != -1) {
+                int capacity = limit - stats.points[j];
+                flow.addEdge(node[j], sink, capacity, capacity - room[j]);
+            }
+        }
+        return placed + flow.maxFlow(source, sink) == needed;
+    }
+
+    // Title and relegation outlook after the stages played so far.
+    // Title: clinched when no other team can reach the leader's points;
+    // otherwise teams are ordered by their maximum points and the title race
+    // check (monotone in that order) is binary searched, so only O(log n)
+    // networks are solved. Safety: clinched when too few teams can still reach
+    // the team's points to push it into the bottom relegationSpots, relegated
+    // when enough teams already have more than its maximum.
+    SeasonOutlook analyzeOutlook(int relegationSpots = 3) {
+        SeasonOutlook outlook;
+        int n = teams.size();
+        relegationSpots = max(0, min(relegationSpots, n));
+        outlook.relegationSpots = relegationSpots;
+        if (n == 0) return outlook;
+
+        FixtureSchedule generated;
+        if (fixtures.empty()) {
+            generated.generate(rosterIds());
+        }
+        const FixtureSchedule& schedule = fixtures.empty() ? generated : fixtures;
+
+        vector<pair<int, int>>& remaining = scratch.remaining;
+        vector<int>& remainingCount = scratch.remainingCount;
+        remaining.clear();
+        remainingCount.assign(n, 0);
+        for (int stage = 0; stage < schedule.stageCount(); stage++) {
+            bool unplayed = !schedule.hasResults(stage);
+            for (int slot = 0; slot < schedule.matchCount(stage); slot++) {
+                if (!unplayed && schedule.at(stage, slot).played) continue;
+                pair<int, int> ids = schedule.teamsAt(stage, slot);
+                int home = teamIndex(ids.first), away = teamIndex(ids.second);
+                if (home == -1 || away == -1) continue;
+                remaining.push_back({home, away});
+                remainingCount[home]++;
+                remainingCount[away]++;
+            }
+        }
+        outlook.remainingMatches = remaining.size();
+
+        vector<int> maxPoints(n);
+        for (int i = 0; i < n; i++) {
+            maxPoints[i] = stats.points[i] + 3 * remainingCount[i];
+        }
+        vector<SeasonOutlook::Status> title(n, SeasonOutlook::OPEN);
+        vector<SeasonOutlook::Status> safety(n, SeasonOutlook::OPEN);
+
+        int leader = ranking[0];
+        bool clinched = true;
+        for (int j = 0; j < n && clinched; j++) {
+            clinched = j == leader || maxPoints[j] < stats.points[leader];
+        }
+        if (clinched) {
+            fill(title.begin(), title.end(), SeasonOutlook::ELIMINATED);
+            title[leader] = SeasonOutlook::CLINCHED;
+        } else {
+            vector<int> order(n);
+            iota(order.begin(), order.end(), 0);
+            sort(order.begin(), order.end(), [&](int a, int b) { return maxPoints[a] > maxPoints[b]; });
+            int low = 1, high = n;  // order[0] can always still win
+            while (low < high) {
+                int mid = (low + high) / 2;
+                if (titleStillPossible(order[mid], maxPoints)) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            for (int i = low; i < n; i++) {
+                title[order[i]] = SeasonOutlook::ELIMINATED;
+            }
+        }
+
+        int safeSpots = n - relegationSpots;
+        vector<int> sortedPoints(stats.points.begin(), stats.points.begin() + n);
+        vector<int> sortedMax(maxPoints);
+        sort(sortedPoints.begin(), sortedPoints.end());
+        sort(sortedMax.begin(), sortedMax.end());
+        for (int i = 0; i < n; i++) {
+            int points = stats.points[i];
+            // Other teams that can still reach i's current points
+            int canReach = sortedMax.end() - lower_bound(sortedMax.begin(), sortedMax.end(), points) - 1;
+            // Other teams already above i's maximum
+            int alreadyAbove = sortedPoints.end() - upper_bound(sortedPoints.begin(), sortedPoints.end(), maxPoints[i]);
+            if (canReach < safeSpots) {
+                safety[i] = SeasonOutlook::CLINCHED;
+            } else if (alreadyAbove >= safeSpots) {
+                safety[i] = SeasonOutlook::ELIMINATED;
+            }
+        }
+
+        for (int t : ranking) {
+            outlook.teamNames.push_back(teams[t].name);
+            outlook.points.push_back(stats.points[t]);
+            outlook.maxPoints.push_back(maxPoints[t]);
+            outlook.title.push_back(title[t]);
+            outlook.safety.push_back(safety[t]);
+        }
+        return outlook;
+    }
+
+    // Print the outlook table (C: clinched, E: eliminated / relegated)
+    void displayOutlook(const SeasonOutlook& outlook, ostream& out = cout) const {
+        const int nameWidth = 50;
+        out << "\n--- " << name << " Outlook (Stage: " << stagesCompleted << ", "
+            << outlook.remainingMatches << " matches left) ---\n";
+        out << left << setw(4) << "Pos"
+            << setw(nameWidth) << "Team"
+            << setw(5) << "Pts"
+            << setw(5) << "Max"
+            << setw(7) << "Title"
+            << "Safety\n";
+        out << string(4 + nameWidth + 23, '-') << endl;
+        for (int i = 0; i < outlook.size(); i++) {
+            out << left << setw(4) << i + 1
+                << setw(nameWidth) << truncateString(outlook.teamNames[i], nameWidth)
+                << setw(5) << outlook.points[i]
+                << setw(5) << outlook.maxPoints[i]
+                << setw(7) << static_cast<char>(outlook.title[i])
+                << static_cast<char>(outlook.safety[i]) << endl;
+        }
+    }
+
+    // One-line-per-race summary of what is already decided
+    void displayOutlookSummary(const SeasonOutlook& outlook, ostream& out = cout) const {
+        int contenders = 0, relegated = 0, safe = 0;
+        string champion;
+        for (int i = 0; i < outlook.size(); i++) {
+            if (outlook.title[i] == SeasonOutlook::CLINCHED) champion = outlook.teamNames[i];
+            contenders += outlook.title[i] != SeasonOutlook::ELIMINATED;
+            safe += outlook.safety[i] == SeasonOutlook::CLINCHED;
+            relegated += outlook.safety[i] == SeasonOutlook::ELIMINATED;
+        }
+        if (!champion.empty()) {
+            out << "Title clinched by " << champion << endl;
+        } else {
+            out << "Title race: " << contenders << " team(s) can still win\n";
+        }
+        out << "Safe from relegation: " << safe << ", relegated: " << relegated << endl;
+    }
+
+    // Format the ranked standings table (terminal table, CSV or JSON) into
+    // the render buffer and return it
+    const string& renderStandings(StandingsFormat format) const {
+        const int nameWidth = 50;  // Max width for team names in the table
+        const int baseWidth = 35;  // Width for other columns
+        render.reset(256 + ranking.size() * (format == StandingsFormat::JSON ? 200 : 4 + nameWidth + baseWidth + 1));
+        
+        if (format == StandingsFormat::TABLE) {
+            render.append("\n--- ").append(name).append(" Standings (Stage: ")
+                  .append(static_cast<long long>(stagesCompleted)).append(") ---\n");
+            if (!tieBreaks.isStandard()) {
+                render.append("Tie-breaks after points: ").append(tieBreaks.toString()).append('\n');
+            }
+            render.padded("Pos", 4).padded("Team", nameWidth).padded("Pts", 5)
+                  .padded("W", 4).padded("D", 4).padded("L", 4)
+                  .padded("GF", 5).padded("GA", 5).padded("GD", 5).append('\n');
+            render.append(4 + nameWidth + baseWidth, '-').append('\n');
+            for (size_t i = 0; i < ranking.size(); i++) {
+                int t = ranking[i];
+                render.padded(static_cast<long long>(i + 1), 4)
+                      .truncated(teams[t].name, nameWidth)
+                      .padded(stats.points[t], 5)
+                      .padded(stats.wins[t], 4)
+                      .padded(stats.draws[t], 4)
+                      .padded(stats.losses[t], 4)
+                      .padded(stats.goalsFor[t], 5)
+                      .padded(stats.goalsAgainst[t], 5)
+                      .padded(stats.goalDifference[t], 5)
+                      .append('\n');
+            }
+        } else if (format == StandingsFormat::CSV) {
+            render.append("Position,Team,Points,Wins,Draws,Losses,GF,GA,GD\n");
+            for (size_t i = 0; i < ranking.size(); i++) {
+                int t = ranking[i];
+                render.append(static_cast<long long>(i + 1)).append(',')
+                      .csvField(teams[t].name).append(',')
+                      .append(static_cast<long long>(stats.points[t])).append(',')
+                      .append(static_cast<long long>(stats.wins[t])).append(',')
+                      .append(static_cast<long long>(stats.draws[t])).append(',')
+                      .append(static_cast<long long>(stats.losses[t])).append(',')
+                      .append(static_cast<long long>(stats.goalsFor[t])).append(',')
+                      .append(static_cast<long long>(stats.goalsAgainst[t])).append(',')
+                      .append(static_cast<long long>(stats.goalDifference[t])).append('\n');
+            }
+        } else {
+            render.append("{\"championship\":").jsonString(name)
+                  .append(",\"stage\":").append(static_cast<long long>(stagesCompleted))
+                  .append(",\"tieBreaks\":").jsonString(tieBreaks.toString())
+                  .append(",\"standings\":[");
+            for (size_t i = 0; i < ranking.size(); i++) {
+                int t = ranking[i];
+                render.append(i == 0 ? "\n" : ",\n")
+                      .append("{\"position\":").append(static_cast<long long>(i + 1))
+                      .append(",\"team\":").jsonString(teams[t].name)
+                      .append(",\"points\":").append(static_cast<long long>(stats.points[t]))
+                      .append(",\"wins\":").append(static_cast<long long>(stats.wins[t]))
+                      .append(",\"draws\":").append(static_cast<long long>(stats.draws[t]))
+                      .append(",\"losses\":").append(static_cast<long long>(stats.losses[t]))
+                      .append(",\"goalsFor\":").append(static_cast<long long>(stats.goalsFor[t]))
+                      .append(",\"goalsAgainst\":").append(static_cast<long long>(stats.goalsAgainst[t]))
+                      .append(",\"goalDifference\":").append(static_cast<long long>(stats.goalDifference[t]))
+                      .append('}');
+            }
+            render.append("\n]}\n");
+        }
+        return render.str();
+    }
+
+    // Display standings sorted by points and goal difference
+    void displayStandings(ostream& out = cout) const {
+        renderStandings(StandingsFormat::TABLE);
+        render.write(out);
+        out.flush();
+    }
+
+    // Write the standings to a file in the given format
+    bool exportStandings(const string& filename, StandingsFormat format) const {
+        ofstream file(filename, ios::binary);
+        if (!file) {
+            cerr << "Error opening file for writing!\n";
+            return false;
+        }
+        renderStandings(format);
+        render.write(file);
+        file.close();
+        if (!file) {
+            cerr << "Error writing to " << filename << endl;
+            return false;
+        }
+        cout << "Standings exported to " << filename << endl;
+        return true;
+    }
+
+    // Export standings to CSV file
+    void exportStandingsToCSV(const string& filename) const {
+        exportStandings(filename, StandingsFormat::CSV);
+    }
+
+    // Get position of a specific team
+    int getTeamPosition(const string& teamName) const {
+        int index = findTeamIndex(teamName);
+        return index != -1 ? rankOf[index] + 1 : -1;
+    }
+
+    // Position of a team right after stage (1-based), from the standings
+    // history (-1 if the team or the standings after that stage are unknown)
+    int getTeamPositionAt(const string& teamName, int stage) const {
+        int index = findTeamIndex(teamName);
+        if (index == -1 || !standingsHistory.recorded(stage - 1)) {
+            return -1;
+        }
+        return standingsHistory.position(index, stage - 1);
+    }
+
+    // Points of a team after every recorded stage, as (stage, points) pairs
+    vector<pair<int, int>> getPointsTrajectory(const string& teamName) const {
+        vector<pair<int, int>> trajectory;
+        int index = findTeamIndex(teamName);
+        for (int stage = 0; index != -1 && stage < standingsHistory.stageCount(); stage++) {
+            if (standingsHistory.recorded(stage)) {
+                trajectory.emplace_back(stage + 1, standingsHistory.points(index, stage));
+            }
+        }
+        return trajectory;
+    }
+
+    // Display a team's position, points and result after every recorded stage
+    bool displayTeamHistory(const string& teamName, ostream& out = cout) const {
+        int index = findTeamIndex(teamName);
+        if (index == -1) {
+            return false;
+        }
+        out << "\n--- " << teams[index].name << " History (" << name << ") ---\n";
+        if (!standingsHistory.enabled()) {
+            out << "No standings history is kept for this league.\n";
+            return true;
+        }
+        out << left << setw(7) << "Stage" << setw(5) << "Pos" << setw(5) << "Pts" << "Result\n";
+        out << string(23, '-') << '\n';
+        for (int stage = 0; stage < standingsHistory.stageCount(); stage++) {
+            if (!standingsHistory.recorded(stage)) continue;
+            out << left << setw(7) << stage + 1
+                << setw(5) << standingsHistory.position(index, stage)
+                << setw(5) << standingsHistory.points(index, stage)
+                << StandingsHistory::outcomeLetter(standingsHistory.outcome(index, stage)) << '\n';
+        }
+        out << flush;
+        return true;
+    }
+
+    // Display the form table: points taken over the last `window` stages up
+    // to the last one played, with each team's results and current position
+    void displayFormTable(int window, ostream& out = cout) const {
+        int last = stagesCompleted - 1;
+        if (window <= 0 || !standingsHistory.recorded(last)) {
+            out << "No standings history for the last stage played!\n";
+            return;
+        }
+        vector<int> formPoints(teams.size());
+        for (size_t t = 0; t < teams.size(); t++) {
+            formPoints[t] = standingsHistory.formPoints(t, last, window);
+        }
+        vector<int> order = ranking;
+        stable_sort(order.begin(), order.end(), [&](int a, int b) { return formPoints[a] > formPoints[b]; });
+        
+        const int nameWidth = 50;
+        int first = max(0, last - window + 1);
+        out << "\n--- " << name << " Form Table (stages " << first + 1 << "-" << last + 1 << ") ---\n";
+        out << left << setw(4) << "Pos" << setw(nameWidth) << "Team" << setw(5) << "Pts"
+            << setw(max(window, 4) + 2) << "Form" << "Overall\n";
+        out << string(4 + nameWidth + 5 + max(window, 4) + 2 + 7, '-') << '\n';
+        for (size_t pos = 0; pos < order.size(); pos++) {
+            int t = order[pos];
+            string form;
+            for (int stage = first; stage <= last; stage++) {
+                if (standingsHistory.recorded(stage)) {
+                    form += StandingsHistory::outcomeLetter(standingsHistory.outcome(t, stage));
+                }
+            }
+            out << left << setw(4) << pos + 1
+                << setw(nameWidth) << truncateString(teams[t].name, nameWidth)
+                << setw(5) << formPoints[t]
+                << setw(max(window, 4) + 2) << form
+                << rankOf[t] + 1 << '\n';
+        }
+        out << flush;
+    }
+
+    // Find team by name (case-insensitive); returns a view with current statistics
+    optional<Team> findTeam(const string& teamName) const {
+        int index = findTeamIndex(teamName);
+        if (index == -1) {
+            return nullopt;
+        }
+        return teamView(index);
+    }
+
+    // Teams matching a name, or with a word starting with it ("univ",
+    // "CFR"), case-insensitive: a whole-name match first, then names that
+    // start with the query, then other word matches (at most limit teams)
+    vector<Team> searchTeams(const string& query, size_t limit = 10) const {
+        vector<Team> found;
+        int exact = findTeamIndex(query);
+        if (exact != -1) {
+            found.push_back(teamView(exact));
+        }
+        for (int id : nameIndex->findPrefix(query, limit + 1)) {
+            int index = teamIndex(id);
+            if (index != -1 && index != exact && found.size() < limit) {
+                found.push_back(teamView(index));
+            }
+        }
+        return found;
+    }
+
+    // Display standings sorted by team value
+    void displayValueStandings() {
+        vector<Team> sorted = *teams;
+        sort(sorted.begin(), sorted.end(), 
+            [](const Team& a, const Team& b) {
+                return a.value > b.value;
+            });
+        
+        const int nameWidth = 50;
+        
+        cout << "\n--- " << name << " Value-Based Standings ---\n";
+        cout << left << setw(4) << "Pos" 
+             << setw(nameWidth) << "Team"
+             << "Value (M€)\n";
+        cout << string(4 + nameWidth + 15, '-') << endl;
+        
+        for (size_t i = 0; i < sorted.size(); i++) {
+            cout << left << setw(4) << i + 1 
+                 << setw(nameWidth) << truncateString(sorted[i].name, nameWidth)
+                 << sorted[i].value << "M\n";
+        }
+    }
+
+    // Value of a metric for every team
+    vector<double> metricValues(Metric metric) const {
+        vector<double> values(teams.size());
+        for (size_t i = 0; i < teams.size(); i++) {
+            switch (metric) {
+                case Metric::POINTS: values[i] = stats.points[i]; break;
+                case Metric::VALUE: values[i] = teams[i].value; break;
+                case Metric::GOAL_DIFFERENCE: values[i] = stats.goalDifference[i]; break;
+                case Metric::GOALS_FOR: values[i] = stats.goalsFor[i]; break;
+                case Metric::POINTS_PER_VALUE:
+                    values[i] = teams[i].value > 0 ? stats.points[i] / teams[i].value : 0.0;
+                    break;
+            }
+        }
+        return values;
+    }
+
+    // 1-based position of every team by a metric: points use the standings
+    // order, other metrics one index sort (ties keep registration order)
+    vector<int> metricPositions(Metric metric, const vector<double>& values) const {
+        vector<int> positions(teams.size());
+        if (metric == Metric::POINTS) {
+            for (size_t i = 0; i < teams.size(); i++) {
+                positions[i] = rankOf[i] + 1;
+            }
+            return positions;
+        }
+        vector<int> order(teams.size());
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&](int a, int b) { return values[a] > values[b]; });
+        for (size_t pos = 0; pos < order.size(); pos++) {
+            positions[order[pos]] = pos + 1;
+        }
+        return positions;
+    }
+
+    // Rank every team by two metrics and measure their agreement, in O(n log n)
+    MetricComparison compareMetrics(Metric first, Metric second) const {
+        MetricComparison comparison;
+        comparison.first = first;
+        comparison.second = second;
+        vector<double> firstValues = metricValues(first);
+        vector<double> secondValues = metricValues(second);
+        comparison.firstPosition = metricPositions(first, firstValues);
+        comparison.secondPosition = metricPositions(second, secondValues);
+        comparison.spearman = spearmanRho(firstValues, secondValues);
+        comparison.kendall = kendallTauB(firstValues, secondValues);
+        return comparison;
+    }
+
+    // Compare two rankings (by default actual standings vs value-based standings)
+    void generateComparisonReport(Metric first = Metric::POINTS, Metric second = Metric::VALUE,
+                                  ostream& out = cout) const {
+        MetricComparison comparison = compareMetrics(first, second);
+        const int nameWidth = 50;
+        
+        out << "\n--- Performance Comparison Report ---\n";
+        out << left << setw(nameWidth) << "Team"
+            << setw(10) << METRICS[static_cast<int>(first)].label
+            << setw(10) << METRICS[static_cast<int>(second)].label
+            << "Diff\n";
+        out << string(nameWidth + 30, '-') << endl;
+        
+        for (size_t i = 0; i < teams.size(); i++) {
+            int firstPos = comparison.firstPosition[i];
+            int secondPos = comparison.secondPosition[i];
+            
+            out << left << setw(nameWidth) << truncateString(teams[i].name, nameWidth)
+                 << setw(10) << firstPos
+                 << setw(10) << secondPos
+                 << (firstPos - secondPos) << endl;
+        }
+        out << fixed << setprecision(3)
+            << "Spearman rho: " << comparison.spearman
+            << ", Kendall tau-b: " << comparison.kendall << endl;
+        out.unsetf(ios::fixed);
+        out << setprecision(6);
+    }
+
+    // Reset all statistics
+    void resetChampionship() {
+        stats.resetAll();
+        stagesCompleted = 0;
+        fixtures.clearResults();
+        rebuildHeadToHead();
+        rebuildRanking();
+        clearHistory();
+        clearStandingsHistory();
+        cout << "Championship statistics reset!\n";
+    }
+
+    // Getter for championship name
+    string getName() const { return name; }
+
+    // Get number of teams
+    int getTeamCount() const { return teams.size(); }
+
+    // Stage progress
+    int getStagesCompleted() const { return stagesCompleted; }
+    int getTotalStages() const { return fixtures.stageCount(); }
+
+    // Random seed driving all match simulation for this championship
+    uint64_t getSeed() const { return seed; }
+    // A new seed starts every stage's attempts over, so the same seed
+    // replays the same results
+    void setSeed(uint64_t newSeed) {
+        seed = newSeed;
+        stagePlays = Cow<vector<uint32_t>>();
+    }
+
+    // Times a stage has been played (0 if never, or not counted)
+    uint32_t getStagePlays(int stage) const {
+        return stage < static_cast<int>(stagePlays.size()) ? stagePlays[stage] : 0;
+    }
+
+    const TieBreakRules& getTieBreaks() const { return tieBreaks; }
+
+    // Change the tie-break rules and re-rank (false if head-to-head rules
+    // are asked for a league too large to keep the matrix)
+    bool setTieBreaks(const TieBreakRules& rules) {
+        if (rules.usesHeadToHead() && static_cast<int>(teams.size()) > HEAD_TO_HEAD_MAX_TEAMS) {
+            cout << "Head-to-head tie-breaks support at most " << HEAD_TO_HEAD_MAX_TEAMS << " teams!\n";
+            return false;
+        }
+        tieBreaks = rules;
+        refreshHeadToHeadRanking();
+        if (headToHead.empty()) {
+            rebuildRanking();
+        }
+        return true;
+    }
+
+    // Save championship data to file (format version 4: teams carry IDs,
+    // generated schedules are stored as a roster plus the played results,
+    // followed by the standings history)
+    void saveToFile(ostream& file) const {
+        file << name << '\n';
+        file << teams.size() << ' ' << stagesCompleted << ' ' << totalStages << ' ' << seed;
+        if (!tieBreaks.isStandard()) {
+            file << ' ' << tieBreaks.toString();
+        }
+        file << '\n';
+        for (size_t i = 0; i < teams.size(); i++) {
+            const Team& team = teams[i];
+            file << team.id << ',' << team.name << ',' << team.value << ',' 
+                 << stats.wins[i] << ',' << stats.draws[i] << ',' 
+                 << stats.losses[i] << ',' << stats.goalsFor[i] << ',' 
+                 << stats.goalsAgainst[i] << '\n';
+        }
+        
+        // Save interned names of teams no longer in the league (still referenced by fixtures)
+        file << teamNames.size() - teams.size() << '\n';
+        for (size_t id = 0; id < teamNames.size(); id++) {
+            if (indexById[id] == -1) {
+                file << id << ',' << teamNames[id] << '\n';
+            }
+        }
+        
+        // Save fixtures: roster line (if generated), then per stage its stored results
+        const vector<int32_t>& roster = fixtures.getRoster();
+        file << fixtures.stageCount() << ' ' << roster.size() << '\n';
+        for (size_t i = 0; i < roster.size(); i++) {
+            file << (i ? "," : "") << roster[i];
+        }
+        if (!roster.empty()) {
+            file << '\n';
+        }
+        for (int stage = 0; stage < fixtures.stageCount(); stage++) {
+            if (fixtures.isGenerated() && !fixtures.hasResults(stage)) {
+                file << 0 << '\n';
+                continue;
+            }
+            int matchCount = fixtures.matchCount(stage);
+            file << matchCount << '\n';
+            for (int slot = 0; slot < matchCount; slot++) {
+                Match match = fixtures.at(stage, slot);
+                if (!fixtures.isGenerated()) {
+                    file << match.homeId << ',' << match.awayId << ',';
+                }
+                file << match.homeGoals << ',' << match.awayGoals << ','
+                     << match.played << '\n';
+            }
+        }
+        
+        // Save the standings history (version 4)
+        standingsHistory.save(file);
+        
+        // Save the play count of every stage (version 6)
+        file << stagePlays.size();
+        for (uint32_t plays : stagePlays) {
+            file << ' ' << plays;
+        }
+        file << '\n';
+    }
+
+    // Wins, draws, losses, goals for and against that the stored played
+    // results add up to, per team index
+    vector<array<int32_t, 5>> resultTotals() const {
+        vector<array<int32_t, 5>> totals(teams.size(), array<int32_t, 5>{});
+        for (int stage = 0; stage < fixtures.stageCount(); stage++) {
+            if (!fixtures.hasResults(stage)) continue;
+            for (int slot = 0; slot < fixtures.matchCount(stage); slot++) {
+                Match match = fixtures.at(stage, slot);
+                int homeIndex = teamIndex(match.homeId);
+                int awayIndex = teamIndex(match.awayId);
+                if (!match.played || homeIndex == -1 || awayIndex == -1) continue;
+                
+                int sign = (match.homeGoals > match.awayGoals) - (match.homeGoals < match.awayGoals);
+                totals[homeIndex][1 - sign]++;
+                totals[awayIndex][1 + sign]++;
+                totals[homeIndex][3] += match.homeGoals;
+                totals[homeIndex][4] += match.awayGoals;
+                totals[awayIndex][3] += match.awayGoals;
+                totals[awayIndex][4] += match.homeGoals;
+            }
+        }
+        return totals;
+    }
+
+    // Append this championship to an archive
+    void writeArchive(ArchiveWriter& out) const {
+        out.str(name);
+        out.signedVarint(stagesCompleted);
+        out.signedVarint(totalStages);
+        out.varint(seed);
+        out.varint(tieBreaks.pack());
+        
+        // Every interned name, indexed by ID, then the teams by ID delta
+        out.varint(teamNames.size());
+        for (const string& teamName : teamNames) {
+            out.str(teamName);
+        }
+        out.varint(teams.size());
+        int previousId = -1;
+        for (const Team& team : teams) {
+            out.signedVarint(team.id - previousId);
+            out.real(team.value);
+            previousId = team.id;
+        }
+        
+        // Statistics not explained by the stored results
+        vector<array<int32_t, 5>> totals = resultTotals();
+        for (size_t i = 0; i < teams.size(); i++) {
+            out.signedVarint(stats.wins[i] - totals[i][0]);
+            out.signedVarint(stats.draws[i] - totals[i][1]);
+            out.signedVarint(stats.losses[i] - totals[i][2]);
+            out.signedVarint(stats.goalsFor[i] - totals[i][3]);
+            out.signedVarint(stats.goalsAgainst[i] - totals[i][4]);
+        }
+        
+        // Fixtures: the roster (ID deltas), or every pairing when not generated
+        const vector<int32_t>& roster = fixtures.getRoster();
+        out.varint(fixtures.stageCount());
+        out.varint(roster.size());
+        previousId = -1;
+        for (int32_t id : roster) {
+            out.signedVarint(id - previousId);
+            previousId = id;
+        }
+        for (int stage = 0; !fixtures.isGenerated() && stage < fixtures.stageCount(); stage++) {
+            out.varint(fixtures.matchCount(stage));
+            for (int slot = 0; slot < fixtures.matchCount(stage); slot++) {
+                pair<int, int> ids = fixtures.teamsAt(stage, slot);
+                out.signedVarint(ids.first);
+                out.signedVarint(ids.second - ids.first);
+            }
+        }
+        
+        // Results per stage
+        for (int stage = 0; stage < fixtures.stageCount(); stage++) {
+            if (!fixtures.hasResults(stage)) {
+                out.byte(ARCHIVE_STAGE_EMPTY);
+                continue;
+            }
+            int matchCount = fixtures.matchCount(stage);
+            bool packed = true;
+            for (int slot = 0; packed && slot < matchCount; slot++) {
+                Match match = fixtures.at(stage, slot);
+                packed = match.played && match.homeGoals < 16 && match.awayGoals < 16;
+            }
+            out.byte(packed ? ARCHIVE_STAGE_PACKED : ARCHIVE_STAGE_FULL);
+            for (int slot = 0; slot < matchCount; slot++) {
+                Match match = fixtures.at(stage, slot);
+                if (packed) {
+                    out.byte(static_cast<uint8_t>(match.homeGoals << 4 | match.awayGoals));
+                } else {
+                    out.varint(match.homeGoals);
+                    out.varint(match.awayGoals);
+                    out.byte(match.played);
+                }
+            }
+        }
+    }
+
+    // Read a championship written by writeArchive (false if it is corrupt)
+    bool readArchive(ArchiveReader& in) {
+        name = in.str();
+        stagesCompleted = in.signedVarint();
+        totalStages = in.signedVarint();
+        seed = in.varint();
+        uint64_t rules = in.varint();
+        if (rules > UINT32_MAX || !tieBreaks.unpack(static_cast<uint32_t>(rules))) {
+            return false;
+        }
+        headToHead.clear();
+        clearHistory();
+        
+        size_t nameCount = in.count();
+        vector<string> names(nameCount);
+        unordered_map<string, int> ids;
+        ids.reserve(nameCount);
+        for (size_t id = 0; id < nameCount && !in.failed(); id++) {
+            names[id] = in.str();
+            ids.emplace(names[id], id);
+        }
+        
+        size_t teamCount = in.count();
+        vector<Team> loadedTeams;
+        vector<int> index(nameCount, -1);
+        loadedTeams.reserve(teamCount);
+        int id = -1;
+        for (size_t i = 0; i < teamCount && !in.failed(); i++) {
+            id += in.signedVarint();
+            if (id < 0 || id >= static_cast<int>(nameCount) || index[id] != -1) {
+                return false;
+            }
+            Team team(names[id], in.real());
+            team.id = id;
+            index[id] = i;
+            loadedTeams.push_back(team);
+        }
+        stats.clear();
+        stats.reserve(teamCount);
+        for (Team& team : loadedTeams) {
+            team.wins = in.signedVarint();
+            team.draws = in.signedVarint();
+            team.losses = in.signedVarint();
+            team.goalsFor = in.signedVarint();
+            team.goalsAgainst = in.signedVarint();
+            stats.push(team);
+            team.resetStats();
+        }
+        if (in.failed()) {
+            return false;
+        }
+        teams = Cow<vector<Team>>(move(loadedTeams));
+        teamNames = Cow<vector<string>>(move(names));
+        teamIds = Cow<unordered_map<string, int>>(move(ids));
+        indexById = Cow<vector<int>>(move(index));
+        
+        // Fixtures
+        size_t stageCount = in.count();
+        size_t rosterCount = in.count();
+        fixtures.clear();
+        if (rosterCount > 0) {
+            vector<int> roster;
+            id = -1;
+            for (size_t i = 0; i < rosterCount && !in.failed(); i++) {
+                id += in.signedVarint();
+                bool bye = id == FixtureSchedule::BYE && i == rosterCount - 1;
+                if (!bye && (id < 0 || id >= static_cast<int>(nameCount))) {
+                    return false;
+                }
+                roster.push_back(id);
+            }
+            if (rosterCount % 2 != 0 || stageCount != (rosterCount - 1) * 2) {
+                return false;
+            }
+            fixtures.generate(roster);
+        } else {
+            vector<vector<Match>> fixtureList(stageCount);
+            for (size_t stage = 0; stage < stageCount && !in.failed(); stage++) {
+                size_t matchCount = in.count();
+                for (size_t slot = 0; slot < matchCount && !in.failed(); slot++) {
+                    int homeId = in.signedVarint();
+                    int awayId = homeId + in.signedVarint();
+                    if (homeId < 0 || awayId < 0 || homeId >= static_cast<int>(nameCount) ||
+                        awayId >= static_cast<int>(nameCount)) {
+                        return false;
+                    }
+                    fixtureList[stage].emplace_back(homeId, awayId);
+                }
+            }
+            fixtures.assign(fixtureList, {});
+        }
+        
+        vector<MatchResult> results;
+        for (int stage = 0; stage < fixtures.stageCount() && !in.failed(); stage++) {
+            uint8_t mode = in.byte();
+            if (mode == ARCHIVE_STAGE_EMPTY) continue;
+            if (mode != ARCHIVE_STAGE_PACKED && mode != ARCHIVE_STAGE_FULL) {
+                return false;
+            }
+            results.resize(fixtures.matchCount(stage));
+            for (MatchResult& result : results) {
+                if (mode == ARCHIVE_STAGE_PACKED) {
+                    uint8_t score = in.byte();
+                    result = {static_cast<uint8_t>(score >> 4), static_cast<uint8_t>(score & 15), 1};
+                } else {
+                    uint64_t homeGoals = in.varint(), awayGoals = in.varint();
+                    if (homeGoals > UINT8_MAX || awayGoals > UINT8_MAX) {
+                        return false;
+                    }
+                    result = {static_cast<uint8_t>(homeGoals), static_cast<uint8_t>(awayGoals),
+                              static_cast<uint8_t>(in.byte() != 0)};
+                }
+            }
+            fixtures.setStageResults(stage, results);
+        }
+        if (in.failed()) {
+            return false;
+        }
+        
+        // Statistics: the stored remainders plus what the results add up to
+        vector<array<int32_t, 5>> totals = resultTotals();
+        for (size_t i = 0; i < teams.size(); i++) {
+            stats.wins[i] += totals[i][0];
+            stats.draws[i] += totals[i][1];
+            stats.losses[i] += totals[i][2];
+            stats.goalsFor[i] += totals[i][3];
+            stats.goalsAgainst[i] += totals[i][4];
+        }
+        rebuildNameIndex();
+        recomputeStandings();
+        clearStandingsHistory();
+        refreshHeadToHeadRanking();
+        return true;
+    }
+
+    // Append this championship to a binary snapshot
+    void writeSnapshot(SnapshotWriter& writer, uint64_t recordOffset) const {
+        SnapshotChampionship record = {};
+        record.name = writer.addString(name);
+        record.teamCount = teams.size();
+        record.nameCount = teamNames.size();
+        record.stagesCompleted = stagesCompleted;
+        record.totalStages = totalStages;
+        record.seed = seed;
+        record.stageCount = fixtures.stageCount();
+        record.tieBreaks = tieBreaks.pack();
+
+        vector<SnapshotTeam> teamRecords;
+        teamRecords.reserve(teams.size());
+        for (size_t i = 0; i < teams.size(); i++) {
+            teamRecords.push_back({teams[i].id, stats.wins[i], teams[i].value, stats.draws[i],
+                                   stats.losses[i], stats.goalsFor[i], stats.goalsAgainst[i]});
+        }
+        record.teamsOffset = writer.append(teamRecords.data(), teamRecords.size());
+
+        vector<SnapshotString> nameRecords;
+        nameRecords.reserve(teamNames.size());
+        for (const string& teamName : teamNames) {
+            nameRecords.push_back(writer.addString(teamName));
+        }
+        record.namesOffset = writer.append(nameRecords.data(), nameRecords.size());
+
+        // Generated schedules only store stages holding results
+        vector<uint32_t> stageSizes;
+        vector<SnapshotMatch> matchRecords;
+        for (int stage = 0; stage < fixtures.stageCount(); stage++) {
+            bool stored = !fixtures.isGenerated() || fixtures.hasResults(stage);
+            int matchCount = stored ? fixtures.matchCount(stage) : 0;
+            stageSizes.push_back(matchCount);
+            for (int slot = 0; slot < matchCount; slot++) {
+                Match match = fixtures.at(stage, slot);
+                matchRecords.push_back({match.homeId, match.awayId,
+                                        static_cast<uint8_t>(match.homeGoals),
+                                        static_cast<uint8_t>(match.awayGoals),
+                                        static_cast<uint8_t>(match.played), 0});
+            }
+        }
+        record.matchCount = matchRecords.size();
+        record.stagesOffset = writer.append(stageSizes.data(), stageSizes.size());
+        record.matchesOffset = writer.append(matchRecords.data(), matchRecords.size());
+        const vector<int32_t>& roster = fixtures.getRoster();
+        record.rosterCount = roster.size();
+        record.rosterOffset = writer.append(roster.data(), roster.size());
+
+        *writer.at<SnapshotChampionship>(recordOffset) = record;
+    }
+
+    // Load championship from a memory-mapped binary snapshot (false if corrupt)
+    bool loadFromSnapshot(const MappedFile& file, const SnapshotHeader& header,
+                          const SnapshotChampionship& record) {
+        const SnapshotTeam* teamRecords = file.view<SnapshotTeam>(record.teamsOffset, record.teamCount);
+        const SnapshotString* nameRecords = file.view<SnapshotString>(record.namesOffset, record.nameCount);
+        const uint32_t* stageSizes = file.view<uint32_t>(record.stagesOffset, record.stageCount);
+        const SnapshotMatch* matchRecords = file.view<SnapshotMatch>(record.matchesOffset, record.matchCount);
+        if (!teamRecords || !nameRecords || !stageSizes || !matchRecords ||
+            !file.readString(header, record.name, name)) {
+            return false;
+        }
+
+        stagesCompleted = record.stagesCompleted;
+        totalStages = record.totalStages;
+        seed = record.seed;
+        if (!tieBreaks.unpack(record.tieBreaks)) {
+            return false;
+        }
+        headToHead.clear();
+        clearHistory();
+
+        vector<string> names(record.nameCount);
+        unordered_map<string, int> ids;
+        ids.reserve(record.nameCount);
+        vector<int> index(record.nameCount, -1);
+        for (uint32_t id = 0; id < record.nameCount; id++) {
+            if (!file.readString(header, nameRecords[id], names[id])) {
+                return false;
+            }
+            ids.emplace(names[id], id);
+        }
+
+        vector<Team> loadedTeams;
+        loadedTeams.reserve(record.teamCount);
+        stats.clear();
+        stats.reserve(record.teamCount);
+        for (uint32_t i = 0; i < record.teamCount; i++) {
+            const SnapshotTeam& t = teamRecords[i];
+            if (t.id < 0 || t.id >= static_cast<int32_t>(record.nameCount) || index[t.id] != -1) {
+                return false;
+            }
+            Team team(names[t.id], t.value);
+            team.id = t.id;
+            index[t.id] = loadedTeams.size();
+            loadedTeams.push_back(team);
+            stats.wins.push_back(t.wins);
+            stats.draws.push_back(t.draws);
+            stats.losses.push_back(t.losses);
+            stats.goalsFor.push_back(t.goalsFor);
+            stats.goalsAgainst.push_back(t.goalsAgainst);
+        }
+        stats.points.resize(record.teamCount);
+        stats.goalDifference.resize(record.teamCount);
+        stats.sortKey.resize(record.teamCount);
+        teams = Cow<vector<Team>>(move(loadedTeams));
+        teamNames = Cow<vector<string>>(move(names));
+        teamIds = Cow<unordered_map<string, int>>(move(ids));
+        indexById = Cow<vector<int>>(move(index));
+        rebuildNameIndex();
+        stats.refreshAll();
+        rebuildRanking();
+
+        const int32_t* roster = file.view<int32_t>(record.rosterOffset, record.rosterCount);
+        if (record.rosterCount > 0) {
+            if (!roster || record.rosterCount % 2 != 0 ||
+                record.stageCount != (record.rosterCount - 1) * 2) {
+                return false;
+            }
+            for (uint32_t i = 0; i < record.rosterCount; i++) {
+                bool bye = roster[i] == FixtureSchedule::BYE && i == record.rosterCount - 1;
+                if (!bye && (roster[i] < 0 || roster[i] >= static_cast<int32_t>(record.nameCount))) {
+                    return false;
+                }
+            }
+            fixtures.generate(vector<int>(roster, roster + record.rosterCount));
+        }
+
+        vector<vector<Match>> explicitList(record.rosterCount > 0 ? 0 : record.stageCount);
+        uint64_t next = 0;
+        for (uint32_t stage = 0; stage < record.stageCount; stage++) {
+            if (stageSizes[stage] > record.matchCount - next) {
+                return false;
+            }
+            if (record.rosterCount > 0 && stageSizes[stage] != 0 &&
+                stageSizes[stage] != static_cast<uint32_t>(fixtures.matchCount(stage))) {
+                return false;
+            }
+            for (uint32_t m = 0; m < stageSizes[stage]; m++, next++) {
+                const SnapshotMatch& r = matchRecords[next];
+                if (record.rosterCount > 0) {
+                    fixtures.setResult(stage, m, r.homeGoals, r.awayGoals, r.played != 0);
+                    continue;
+                }
+                if (r.homeId < 0 || r.homeId >= static_cast<int32_t>(record.nameCount) ||
+                    r.awayId < 0 || r.awayId >= static_cast<int32_t>(record.nameCount)) {
+                    return false;
+                }
+                Match match(r.homeId, r.awayId);
+                match.homeGoals = r.homeGoals;
+                match.awayGoals = r.awayGoals;
+                match.played = r.played != 0;
+                explicitList[stage].push_back(match);
+            }
+        }
+        if (record.rosterCount == 0) {
+            fixtures.assign(explicitList, rosterIds());
+        }
+        clearStandingsHistory();
+        refreshHeadToHeadRanking();
+        return true;
+    }
+
+    // Line readers for data files, which may have been saved with CRLF line endings
+    static void readLine(istream& in, string& line) {
+        getline(in, line);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+    }
+    static void skipLine(istream& in) {
+        in.ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+
+    // Load championship data from file (version 1: names in fixtures, version 2: IDs,
+    // version 3: roster-based fixtures, version 4: standings history)
+    void loadFromFile(istream& file, int version) {
+        readLine(file, name);
+        
+        int teamCount = 0;
+        file >> teamCount >> stagesCompleted >> totalStages;
+        
+        // Optional seed and tie-break rules (older files do not store them)
+        string rest;
+        getline(file, rest);
+        stringstream seedStream(rest);
+        uint64_t storedSeed;
+        string rules;
+        if (seedStream >> storedSeed) {
+            seed = storedSeed;
+        }
+        tieBreaks = TieBreakRules();
+        if (seedStream >> rules) {
+            tieBreaks.parse(rules);
+        }
+        headToHead.clear();
+        
+        teams = Cow<vector<Team>>();
+        stats.clear();
+        ranking.clear();
+        rankOf.clear();
+        clearHistory();
+        teamNames = Cow<vector<string>>();
+        teamIds = Cow<unordered_map<string, int>>();
+        indexById = Cow<vector<int>>();
+        
+        // Place a name at a stored ID. IDs are dense over the league and
+        // retired teams, so an ID outside them means a damaged file.
+        int idLimit = 0;
+        auto internWithId = [&](int id, const string& teamName) {
+            if (id < 0 || id >= idLimit) {
+                throw runtime_error("team ID out of range");
+            }
+            if (id >= static_cast<int>(teamNames.size())) {
+                teamNames.mut().resize(id + 1);
+                indexById.mut().resize(id + 1, -1);
+            }
+            teamNames.mut()[id] = teamName;
+            teamIds.mut()[teamName] = id;
+        };
+        
+        auto splitLine = [&](vector<string>& tokens) {
+            string line;
+            readLine(file, line);
+            stringstream ss(line);
+            string token;
+            tokens.clear();
+            while (getline(ss, token, ',')) {
+                tokens.push_back(token);
+            }
+        };
+        
+        vector<string> tokens;
+        vector<Team> loadedTeams;
+        vector<int> loadedIds;
+        const size_t teamFields = version >= 2 ? 8 : 7;
+        for (int i = 0; i < teamCount && file; i++) {
+            splitLine(tokens);
+            
+            if (tokens.size() == teamFields) {
+                size_t f = teamFields - 7;  // Offset past the ID column
+                Team team(tokens[f], stod(tokens[f + 1]));
+                team.wins = stoi(tokens[f + 2]);
+                team.draws = stoi(tokens[f + 3]);
+                team.losses = stoi(tokens[f + 4]);
+                team.goalsFor = stoi(tokens[f + 5]);
+                team.goalsAgainst = stoi(tokens[f + 6]);
+                if (version >= 2) {
+                    loadedIds.push_back(stoi(tokens[0]));
+                }
+                loadedTeams.push_back(team);
+            }
+        }
+        
+        // The retired teams follow the league, and their count bounds the IDs
+        if (version >= 2) {
+            int retiredCount = 0;
+            file >> retiredCount;
+            skipLine(file);
+            idLimit = teamCount + max(retiredCount, 0);
+            for (size_t i = 0; i < loadedIds.size(); i++) {
+                internWithId(loadedIds[i], loadedTeams[i].name);
+            }
+            for (int i = 0; i < retiredCount && file; i++) {
+                splitLine(tokens);
+                if (tokens.size() == 2) {
+                    internWithId(stoi(tokens[0]), tokens[1]);
+                }
+            }
+        }
+        for (const Team& team : loadedTeams) {
+            appendTeam(team);
+        }
+        rebuildNameIndex();
+        rebuildRanking();
+        
+        // Load fixtures
+        int stageCount = 0;
+        size_t rosterSize = 0;
+        file >> stageCount;
+        if (version >= 3) {
+            file >> rosterSize;
+        }
+        skipLine(file);
+        
+        fixtures.clear();
+        if (rosterSize > 0) {
+            splitLine(tokens);
+            vector<int> roster;
+            for (const string& token : tokens) {
+                roster.push_back(stoi(token));
+            }
+            fixtures.generate(roster);
+            for (int i = 0; i < stageCount && i < fixtures.stageCount() && file; i++) {
+                int matchCount = 0;
+                file >> matchCount;
+                skipLine(file);
+                for (int j = 0; j < matchCount && file; j++) {
+                    splitLine(tokens);
+                    if (tokens.size() == 3 && j < fixtures.matchCount(i)) {
+                        int homeGoals = stoi(tokens[0]), awayGoals = stoi(tokens[1]);
+                        if (!MatchResult::fits(homeGoals, awayGoals)) {
+                            throw runtime_error("score out of range");
+                        }
+                        fixtures.setResult(i, j, homeGoals, awayGoals, tokens[2] == "1");
+                    }
+                }
+            }
+        } else {
+            loadFixtureList(file, version, stageCount, splitLine, tokens);
+        }
+        
+        clearStandingsHistory();
+        if (version >= 4) {
+            standingsHistory.load(file);
+        }
+        stagePlays = Cow<vector<uint32_t>>();
+        if (version >= 6) {
+            size_t count = 0;
+            file >> count;
+            vector<uint32_t> counts;
+            uint32_t plays;
+            for (size_t i = 0; i < count && file >> plays; i++) {
+                counts.push_back(plays);
+            }
+            skipLine(file);
+            if (counts.size() == count && count <= static_cast<size_t>(fixtures.stageCount())) {
+                stagePlays = Cow<vector<uint32_t>>(move(counts));
+            }
+        }
+        refreshHeadToHeadRanking();
+    }
+
+    // Explicit fixture list of a data file (versions 1 and 2, and version 3
+    // files whose fixtures were not generated)
+    template <typename SplitLine>
+    void loadFixtureList(istream& file, int version, int stageCount, SplitLine& splitLine,
+                         vector<string>& tokens) {
+        vector<vector<Match>> fixtureList;
+        for (int i = 0; i < stageCount && file; i++) {
+            int matchCount = 0;
+            file >> matchCount;
+            skipLine(file);
+            
+            vector<Match> stageMatches;
+            for (int j = 0; j < matchCount && file; j++) {
+                splitLine(tokens);
+                
+                if (tokens.size() == 5) {
+                    Match match = version >= 2
+                        ? Match(stoi(tokens[0]), stoi(tokens[1]))
+                        : Match(internTeam(tokens[0]), internTeam(tokens[1]));
+                    match.homeGoals = stoi(tokens[2]);
+                    match.awayGoals = stoi(tokens[3]);
+                    match.played = tokens[4] == "1";
+                    if (!MatchResult::fits(match.homeGoals, match.awayGoals)) {
+                        throw runtime_error("score out of range");
+                    }
+                    stageMatches.push_back(match);
+                }
+            }
+            fixtureList.push_back(stageMatches);
+        }
+        
+        // Older files store every fixture; adopt the roster form when they match it
+        fixtures.assign(fixtureList, rosterIds());
+    }
+};
+
+// Data file format version written by saveData (5: championship index table,
+// 6: stage play counts)
+const int DATA_FORMAT_VERSION = 6;
+
+// ===== Championship registry =====
+
+// Reference to a registry slot plus the generation of the championship that
+// filled it. A slot's generation changes whenever its championship is
+// destroyed, so a stale handle resolves to null instead of to whichever
+// championship reused the slot.
+struct ChampionshipHandle {
+    uint32_t slot;
+    uint32_t generation;
+
+    ChampionshipHandle() : slot(UINT32_MAX), generation(0) {}
+    ChampionshipHandle(uint32_t slot, uint32_t generation) : slot(slot), generation(generation) {}
+
+    bool operator==(const ChampionshipHandle& other) const {
+        return slot == other.slot && generation == other.generation;
+    }
+};
+
+// Indexed data file that championships are parsed from on first use. The
+// streams stay open, so a save that replaces the file does not affect
+// championships that have not been read yet. The writer and the query server
+// thread each read through their own stream, so neither waits for the other.
+struct LazyDataFile {
+    ifstream file;          // Read by the writer thread
+    ifstream serverFile;    // Read by the query server thread
+    int version;
+};
+
+// Thread a block is read on (which of the data file's streams it uses)
+enum class LazyReader { WRITER, SERVER };
+
+// A championship that has not been parsed yet: the location of its block in
+// a data file and what is known without parsing it
+struct LazyChampionship {
+    shared_ptr<LazyDataFile> source;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    string name;
+    int teamCount = 0;
+    optional<uint64_t> seed;     // Applied once parsed
+
+    // Raw text of the block
+    string read(LazyReader reader = LazyReader::WRITER) const {
+        ifstream& file = reader == LazyReader::SERVER ? source->serverFile : source->file;
+        string block(size, '\0');
+        file.clear();
+        file.seekg(offset);
+        file.read(&block[0], block.size());
+        block.resize(file.gcount());
+        return block;
+    }
+
+    // Parse the block into champ. A block that cannot be parsed leaves an
+    // empty championship of its name, and its raw text in damaged (if given)
+    // so that a full save can write it back unchanged.
+    void parse(Championship& champ, LazyReader reader = LazyReader::WRITER,
+               string* damaged = nullptr) const {
+        string block = read(reader);
+        istringstream in(block);
+        try {
+            champ.loadFromFile(in, source->version);
+            // The parser skips lines it cannot read, so check the team count
+            // against the index as well
+            if ((in.fail() && !in.eof()) || champ.getTeamCount() != teamCount) {
+                throw runtime_error("damaged championship block");
+            }
+        } catch (const exception&) {
+            cerr << "Championship " << name << " is damaged and could not be loaded\n";
+            champ = Championship(name);
+            if (damaged) {
+                *damaged = move(block);
+            }
+        }
+        if (seed) {
+            champ.setSeed(*seed);
+        }
+    }
+};
+
+// Championships in creation order, held in fixed-size chunks of slots that
+// are allocated once and never moved. Adding championships never relocates
+// existing ones, so pointers, references and handles held by other code (or
+// other threads) stay valid until the registry is cleared. Cleared slots are
+// reused under a new generation. A slot can also hold a championship that
+// has not been parsed yet: only its name, team count and the location of its
+// block in a data file are known until it is first accessed.
+class ChampionshipRegistry {
+private:
+    static const size_t CHUNK_SLOTS = 32;
+
+    struct Slot {
+        optional<Championship> championship;
+        uint32_t generation = 0;
+        LazyChampionship lazy;       // Until parsed: the block in its data file
+        string damagedBlock;         // Raw text of a block that could not be parsed
+        int damagedTeamCount = 0;    // Team count its index entry gave
+    };
+
+    vector<unique_ptr<Slot[]>> chunks;
+    size_t count;
+
+    Slot& slotAt(size_t index) { return chunks[index / CHUNK_SLOTS][index % CHUNK_SLOTS]; }
+    const Slot& slotAt(size_t index) const { return chunks[index / CHUNK_SLOTS][index % CHUNK_SLOTS]; }
+
+    Slot& claimSlot() {
+        if (count == chunks.size() * CHUNK_SLOTS) {
+            chunks.push_back(make_unique<Slot[]>(CHUNK_SLOTS));
+        }
+        return slotAt(count++);
+    }
+
+    // The slot's championship, parsing it first if needed
+    Championship& parsed(Slot& slot) {
+        if (!slot.championship) {
+            slot.lazy.parse(slot.championship.emplace(), LazyReader::WRITER, &slot.damagedBlock);
+            slot.damagedTeamCount = slot.lazy.teamCount;
+            slot.lazy = LazyChampionship();
+        }
+        return *slot.championship;
+    }
+
+    // Whether a damaged block stands in for the slot's championship: until
+    // teams are added to the empty championship that replaced it, saves keep
+    // the block so a later repair of the file can still recover it
+    static bool keepsDamagedBlock(const Slot& slot) {
+        return !slot.damagedBlock.empty() && slot.championship->getTeamCount() == 0;
+    }
+
+public:
+    ChampionshipRegistry() : count(0) {}
+    ChampionshipRegistry(const ChampionshipRegistry&) = delete;
+    ChampionshipRegistry& operator=(const ChampionshipRegistry&) = delete;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    Championship& operator[](size_t index) { return parsed(slotAt(index)); }
+    Championship& back() { return (*this)[count - 1]; }
+
+    // Construct a championship in the next slot
+    template <typename... Args>
+    Championship& emplace_back(Args&&... args) {
+        Slot& slot = claimSlot();
+        slot.championship.emplace(forward<Args>(args)...);
+        return *slot.championship;
+    }
+
+    // Add a championship that is parsed from size bytes at offset of a data
+    // file when first accessed
+    void emplaceLazy(shared_ptr<LazyDataFile> source, uint64_t offset, uint64_t size,
+                     const string& name, int teamCount) {
+        Slot& slot = claimSlot();
+        slot.lazy.source = move(source);
+        slot.lazy.offset = offset;
+        slot.lazy.size = size;
+        slot.lazy.name = name;
+        slot.lazy.teamCount = teamCount;
+    }
+
+    bool isParsed(size_t index) const { return slotAt(index).championship.has_value(); }
+
+    // Where a championship that is not parsed yet comes from
+    const LazyChampionship& lazyAt(size_t index) const { return slotAt(index).lazy; }
+
+    // Name and team count, without parsing the championship
+    string nameAt(size_t index) const {
+        const Slot& slot = slotAt(index);
+        return slot.championship ? slot.championship->getName() : slot.lazy.name;
+    }
+    int teamCountAt(size_t index) const {
+        const Slot& slot = slotAt(index);
+        if (!slot.championship) {
+            return slot.lazy.teamCount;
+        }
+        return keepsDamagedBlock(slot) ? slot.damagedTeamCount : slot.championship->getTeamCount();
+    }
+
+    // Set a championship's seed, deferring it until the championship is parsed
+    void setSeedAt(size_t index, uint64_t seed) {
+        Slot& slot = slotAt(index);
+        if (slot.championship) {
+            slot.championship->setSeed(seed);
+        } else {
+            slot.lazy.seed = seed;
+        }
+    }
+
+    // A championship in data file format version: unparsed blocks of that
+    // version are copied as they are, and damaged blocks are copied whatever
+    // their version
+    void saveAt(size_t index, ostream& out, int version) {
+        Slot& slot = slotAt(index);
+        if (!slot.championship && !slot.lazy.seed && slot.lazy.source->version == version) {
+            out << slot.lazy.read();
+        } else if (slot.championship && keepsDamagedBlock(slot)) {
+            out << slot.damagedBlock;
+        } else {
+            parsed(slot).saveToFile(out);
+        }
+    }
+
+    // Parse every championship (so no data file is held open)
+    void parseAll() {
+        for (size_t i = 0; i < count; i++) {
+            parsed(slotAt(i));
+        }
+    }
+
+    Championship& push_back(Championship&& champ) { return emplace_back(move(champ)); }
+
+    // Destroy every championship; handles to them go stale
+    void clear() {
+        for (size_t i = 0; i < count; i++) {
+            Slot& slot = slotAt(i);
+            slot.championship.reset();
+            slot.lazy = LazyChampionship();
+            slot.damagedBlock.clear();
+            slot.generation++;
+        }
+        count = 0;
+    }
+
+    ChampionshipHandle handleAt(size_t index) const {
+        return ChampionshipHandle(index, slotAt(index).generation);
+    }
+
+    // Championship a handle refers to (null if it was destroyed)
+    Championship* get(ChampionshipHandle handle) {
+        if (handle.slot >= count || slotAt(handle.slot).generation != handle.generation) {
+            return nullptr;
+        }
+        return &parsed(slotAt(handle.slot));
+    }
+
+    // Position of a championship held by this registry (-1 if it is not)
+    int indexOf(const Championship* champ) const {
+        less_equal<const void*> notAfter;
+        for (size_t c = 0; champ && c < chunks.size(); c++) {
+            const Slot* first = &chunks[c][0];
+            const Slot* last = &chunks[c][CHUNK_SLOTS - 1];
+            if (notAfter(first, champ) && notAfter(champ, last)) {
+                size_t index = c * CHUNK_SLOTS + (reinterpret_cast<const char*>(champ) -
+                                                  reinterpret_cast<const char*>(first)) / sizeof(Slot);
+                return index < count ? static_cast<int>(index) : -1;
+            }
+        }
+        return -1;
+    }
+
+    ChampionshipHandle handleOf(const Championship* champ) const {
+        int index = indexOf(champ);
+        return index == -1 ? ChampionshipHandle() : handleAt(index);
+    }
+};
+
+// Global variables
+ChampionshipRegistry championships;
+
+// The selected championship, held as a handle so it reads as null once the
+// registry it came from is cleared (loading data replaces every championship)
+class SelectedChampionship {
+private:
+    ChampionshipHandle handle;
+
+public:
+    SelectedChampionship& operator=(Championship* champ) {
+        handle = championships.handleOf(champ);
+        return *this;
+    }
+
+    Championship* get() const { return championships.get(handle); }
+    operator Championship*() const { return get(); }
+    Championship* operator->() const { return get(); }
+};
+
+SelectedChampionship currentChampionship;
+bool hasSeedOverride = false;   // Set by --seed to replay runs bit-for-bit
+uint64_t seedOverride = 0;
+
+// Change journal written next to a text data file (<data file>.journal).
+// Every change since the last full save is one line; changes are collected
+// in memory and a save only appends them to the journal, and loadData
+// replays it on top of the data file. Both files carry a generation number so a journal left over
+// from an older full save is never replayed twice.
+//
+//   FCMJ 1 <generation>                 header
+//   C <name>                            championship created
+//   P <championship> <value> <name>     team promoted
+//   R <championship> <name>             team relegated
+//   G <championship>                    fixtures generated
+//   S <championship> <stage> <plays> <results>
+//                                       stage played (plays: the stage's play
+//                                       count afterwards, since version 2);
+//                                       results are h-a or x
+//   F <championship> <name>             championship forked
+//   X <championship>                    statistics reset
+//   K <championship> <seed>             seed changed, or set by create
+//   T <championship> <rules>            tie-break rules changed
+//   U|Y <championship> <delta>          stage play undone / redone, with the
+//                                       whole delta (stage, stages completed
+//                                       before and after, replay flag, count
+//                                       of old results, old and new results)
+const int JOURNAL_FORMAT_VERSION = 2;
+const uint64_t JOURNAL_COMPACT_BYTES = 1 << 20;  // Full save once the journal grows past this
+
+class ResultJournal {
+private:
+    string path;          // Empty while detached
+    string dataFile;
+    uint64_t generation;
+    uint64_t bytes;       // Journal size on disk
+    string pending;       // Records not saved yet
+    bool restart;         // Start a new journal file on the first commit
+#ifdef _WIN32
+    ofstream file;
+    bool isOpen() const { return file.is_open(); }
+#else
+    int fd;
+    bool isOpen() const { return fd >= 0; }
+#endif
+
+    // Open the journal file for appending, creating or trimming it first
+    bool openFile() {
+        if (restart) {
+            ofstream header(path, ios::trunc);
+            header << "FCMJ " << JOURNAL_FORMAT_VERSION << ' ' << generation << '\n';
+            if (!header) return false;
+            bytes = header.tellp();
+        } else {
+            // Drop a torn record left by a crash in the middle of an append
+            error_code error;
+            filesystem::resize_file(path, bytes, error);
+            if (error) return false;
+        }
+#ifdef _WIN32
+        file.open(path, ios::app);
+        return file.is_open();
+#else
+        fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+        return fd >= 0;
+#endif
+    }
+
+    bool write(const string& text) {
+#ifdef _WIN32
+        file << text << flush;
+        return static_cast<bool>(file);
+#else
+        size_t done = 0;
+        while (done < text.size()) {
+            ssize_t n = ::write(fd, text.data() + done, text.size() - done);
+            if (n < 0) return false;
+            done += n;
+        }
+        return true;
+#endif
+    }
+
+public:
+    ResultJournal() : generation(0), bytes(0), restart(false) {
+#ifndef _WIN32
+        fd = -1;
+#endif
+    }
+    ~ResultJournal() { detach(); }
+
+    static string pathFor(const string& dataFile) { return dataFile + ".journal"; }
+
+    // Start journaling changes to dataFile, written at newGeneration. With
+    // startNew (after a full save) the first commit replaces any old journal;
+    // otherwise records follow the first keepBytes bytes of the existing one.
+    // The file is only touched once there is something to commit.
+    void attach(const string& newDataFile, uint64_t newGeneration, bool startNew, uint64_t keepBytes = 0) {
+        detach();
+        path = pathFor(newDataFile);
+        dataFile = newDataFile;
+        generation = newGeneration;
+        restart = startNew;
+        bytes = keepBytes;
+    }
+
+    void detach() {
+#ifdef _WIN32
+        if (file.is_open()) file.close();
+#else
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        path.clear();
+        dataFile.clear();
+        pending.clear();
+    }
+
+    bool isAttachedTo(const string& file) const { return !path.empty() && dataFile == file; }
+    uint64_t size() const { return bytes + pending.size(); }
+
+    // Append the pending records to the journal and flush them to disk. On
+    // failure the journal may end in a torn record, which replay ignores;
+    // the caller then falls back to a full save.
+    bool commit() {
+        if (path.empty()) return false;
+        if (pending.empty()) return true;
+        if ((!isOpen() && !openFile()) || !write(pending)) return false;
+#ifdef _WIN32
+        if (!file.flush()) return false;
+#else
+        if (fsync(fd) != 0) return false;
+#endif
+        bytes += pending.size();
+        pending.clear();
+        return true;
+    }
+
+    // Record one change (no-op while detached)
+    void append(const string& record) {
+        if (path.empty()) return;
+        pending += record;
+        pending += '\n';
+    }
+
+    void recordCreate(const string& name) { append("C " + name); }
+    void recordPromote(int championship, const Team& team) {
+        ostringstream record;
+        record << "P " << championship << ' ' << team.value << ' ' << team.name;
+        append(record.str());
+    }
+    void recordRelegate(int championship, const string& name) {
+        append("R " + to_string(championship) + ' ' + name);
+    }
+    void recordGenerate(int championship) { append("G " + to_string(championship)); }
+    void recordFork(int championship, const string& name) {
+        append("F " + to_string(championship) + ' ' + name);
+    }
+    static void appendResults(string& record, const vector<MatchResult>& results) {
+        for (const MatchResult& result : results) {
+            record += result.played ? ' ' + to_string(result.homeGoals) + '-' + to_string(result.awayGoals)
+                                    : string(" x");
+        }
+    }
+    void recordStage(int championship, const Championship& champ, int stage) {
+        if (path.empty()) return;
+        string record = "S " + to_string(championship) + ' ' + to_string(stage) + ' ' +
+                        to_string(champ.getStagePlays(stage));
+        appendResults(record, champ.getStageResults(stage));
+        append(record);
+    }
+    void recordDelta(int championship, const StageDelta& delta, bool undo) {
+        if (path.empty()) return;
+        string record = string(undo ? "U " : "Y ") + to_string(championship) + ' ' + to_string(delta.stage) +
+                        ' ' + to_string(delta.completedBefore) + ' ' + to_string(delta.completedAfter) +
+                        ' ' + to_string(delta.replay) + ' ' + to_string(delta.before.size());
+        appendResults(record, delta.before);
+        appendResults(record, delta.after);
+        append(record);
+    }
+    void recordReset(int championship) { append("X " + to_string(championship)); }
+    void recordSeed(int championship, uint64_t seed) {
+        append("K " + to_string(championship) + ' ' + to_string(seed));
+    }
+    void recordTieBreaks(int championship, const TieBreakRules& rules) {
+        append("T " + to_string(championship) + ' ' + rules.toString());
+    }
+};
+
+ResultJournal journal;
+
+// Position of a championship in the global list (journal records refer to it)
+int championshipIndex(const Championship* champ) {
+    return championships.indexOf(champ);
+}
+
+// Read up to `count` results (h-a or x) of a journal record
+bool readJournalResults(istream& in, vector<MatchResult>& results, size_t count) {
+    string token;
+    while (results.size() < count && in >> token) {
+        int homeGoals = 0, awayGoals = 0;
+        bool played = token != "x";
+        if (played && sscanf(token.c_str(), "%d-%d", &homeGoals, &awayGoals) != 2) return false;
+        if (!MatchResult::fits(homeGoals, awayGoals)) return false;
+        results.push_back({static_cast<uint8_t>(homeGoals), static_cast<uint8_t>(awayGoals),
+                           static_cast<uint8_t>(played)});
+    }
+    return count == SIZE_MAX || results.size() == count;
+}
+
+// Apply one journal record of a journal format version; false if it is
+// malformed or does not apply
+bool applyJournalRecord(const string& line, int version) {
+    istringstream in(line);
+    char type;
+    if (!(in >> type)) return false;
+    
+    if (type == 'C') {
+        string name;
+        in.ignore();
+        getline(in, name);
+        championships.emplace_back(name);
+        return true;
+    }
+    
+    size_t index;
+    if (!(in >> index) || index >= championships.size()) return false;
+    Championship& champ = championships[index];
+    switch (type) {
+        case 'P': {
+            double value;
+            string name;
+            if (!(in >> value)) return false;
+            in.ignore();
+            getline(in, name);
+            return champ.promoteTeam(Team(name, value));
+        }
+        case 'R': {
+            string name;
+            in.ignore();
+            getline(in, name);
+            return champ.relegateTeam(name);
+        }
+        case 'G':
+            champ.generateFixtures();
+            return true;
+        case 'F': {
+            string name;
+            in.ignore();
+            getline(in, name);
+            championships.push_back(champ.fork(name));
+            return true;
+        }
+        case 'S': {
+            int stage;
+            uint32_t plays = 0;
+            vector<MatchResult> results;
+            if (!(in >> stage) || (version >= 2 && !(in >> plays)) ||
+                !readJournalResults(in, results, SIZE_MAX)) {
+                return false;
+            }
+            return champ.applyStageResults(stage, results, plays);
+        }
+        case 'U':
+        case 'Y': {
+            StageDelta delta;
+            size_t beforeCount;
+            if (!(in >> delta.stage >> delta.completedBefore >> delta.completedAfter >> delta.replay >> beforeCount) ||
+                !readJournalResults(in, delta.before, beforeCount) ||
+                !readJournalResults(in, delta.after, SIZE_MAX)) {
+                return false;
+            }
+            return champ.applyExternalDelta(delta, type == 'U');
+        }
+        case 'X':
+            champ.resetChampionship();
+            return true;
+        case 'K': {
+            uint64_t seed;
+            if (!(in >> seed)) return false;
+            champ.setSeed(seed);
+            return true;
+        }
+        case 'T': {
+            string text;
+            TieBreakRules rules;
+            return in >> text && rules.parse(text) && champ.setTieBreaks(rules);
+        }
+    }
+    return false;
+}
+
+// Replay the journal of a data file written at `generation`. Returns the
+// number of bytes of valid records (0 if there is no usable journal) and
+// sets version to the journal's format version; replay stops at the first
+// incomplete or malformed record.
+uint64_t replayJournal(const string& dataFile, uint64_t generation, int& applied, int& version) {
+    applied = 0;
+    ifstream file(ResultJournal::pathFor(dataFile), ios::binary);
+    string line;
+    if (!file || !getline(file, line)) return 0;
+    
+    istringstream header(line);
+    string magic;
+    uint64_t journalGeneration;
+    if (!(header >> magic >> version >> journalGeneration) || magic != "FCMJ" ||
+        version > JOURNAL_FORMAT_VERSION || journalGeneration != generation) {
+        return 0;
+    }
+    
+    // Replay quietly: the records re-run the championship operations
+    NullBuffer nullBuffer;
+    streambuf* console = cout.rdbuf(&nullBuffer);
+    uint64_t valid = line.size() + 1;
+    while (getline(file, line)) {
+        if (file.eof() || !applyJournalRecord(line, version)) break;  // Torn or bad record
+        valid += line.size() + 1;
+        applied++;
+    }
+    cout.rdbuf(console);
+    return valid;
+}
+
+// Write a whole file so that a crash leaves either the old or the new
+// contents: write a temporary file, flush it to disk, then rename it over
+bool writeFileAtomically(const string& filename, const string& contents) {
+    string tempName = filename + ".tmp";
+#ifdef _WIN32
+    {
+        ofstream file(tempName, ios::binary | ios::trunc);
+        file.write(contents.data(), contents.size());
+        if (!file.flush()) return false;
+    }
+    remove(filename.c_str());
+    return rename(tempName.c_str(), filename.c_str()) == 0;
+#else
+    int fd = ::open(tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t done = 0;
+    while (done < contents.size()) {
+        ssize_t n = ::write(fd, contents.data() + done, contents.size() - done);
+        if (n < 0) {
+            ::close(fd);
+            return false;
+        }
+        done += n;
+    }
+    bool ok = fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || rename(tempName.c_str(), filename.c_str()) != 0) return false;
+    
+    // Persist the rename itself
+    size_t slash = filename.find_last_of('/');
+    string directory = slash == string::npos ? "." : filename.substr(0, slash + 1);
+    int dirFd = ::open(directory.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+#endif
+}
+
+// Save all championships to file
+bool saveData(const string& filename) {
+    // Only the changes since the last save have to be appended to the journal
+    if (journal.isAttachedTo(filename) && journal.size() < JOURNAL_COMPACT_BYTES && journal.commit()) {
+        cout << "Data saved successfully to " << filename << endl;
+        return true;
+    }
+    
+    // Full save under a new generation, then restart the journal
+#ifdef _WIN32
+    championships.parseAll();  // The data file cannot be replaced while it is open
+#endif
+    uint64_t generation = MatchRng::randomSeed() | 1;  // Never 0, which marks files without a journal
+    ostringstream body;
+    vector<uint64_t> offsets;
+    for (size_t i = 0; i < championships.size(); i++) {
+        offsets.push_back(body.tellp());
+        championships.saveAt(i, body, DATA_FORMAT_VERSION);
+    }
+    offsets.push_back(body.tellp());
+    
+    // Index table: offset (from the end of the table), size, team count and
+    // name of each championship, so loading can skip to any of them
+    ostringstream file;
+    file << "FCM " << DATA_FORMAT_VERSION << ' ' << generation << '\n';
+    file << championships.size() << '\n';
+    for (size_t i = 0; i < championships.size(); i++) {
+        file << offsets[i] << ' ' << offsets[i + 1] - offsets[i] << ' '
+             << championships.teamCountAt(i) << ' ' << championships.nameAt(i) << '\n';
+    }
+    file << body.str();
+    
+    if (!writeFileAtomically(filename, file.str())) {
+        cerr << "Error opening file for writing!\n";
+        return false;
+    }
+    journal.attach(filename, generation, true);
+    
+    cout << "Data saved successfully to " << filename << endl;
+    return true;
+}
+
+// Load all championships from file
+bool loadData(const string& filename) {
+    auto source = make_shared<LazyDataFile>();
+    ifstream& file = source->file;
+    file.open(filename, ios::binary);
+    source->serverFile.open(filename, ios::binary);
+    if (!file || !source->serverFile) {
+        cerr << "Error opening file for reading!\n";
+        return false;
+    }
+    
+    // Versioned files start with "FCM <version> [generation]"; older files start with the count
+    int version = 1;
+    uint64_t generation = 0;
+    string header;
+    file >> header;
+    if (header == "FCM") {
+        file >> version;
+        string rest;
+        getline(file, rest);
+        istringstream(rest) >> generation;
+        file >> header;
+    }
+    int count = -1;
+    const char* headerEnd = header.data() + header.size();
+    if (!file || from_chars(header.data(), headerEnd, count).ptr != headerEnd || count < 0 || version < 1) {
+        cerr << "Not a championship data file: " << filename << endl;
+        return false;
+    }
+    file.ignore(numeric_limits<streamsize>::max(), '\n');
+    
+    if (version > DATA_FORMAT_VERSION) {
+        cerr << "Unsupported data file version " << version << "!\n";
+        return false;
+    }
+    
+    // Everything is read and checked before the loaded championships are replaced
+    vector<uint64_t> offsets, sizes;
+    vector<int> teamCounts;
+    vector<string> names;
+    vector<Championship> loaded;
+    uint64_t bodyStart = 0;
+    bool valid = true;
+    bool crlf = false;
+    if (version >= 5) {
+        // Read only the index; championships are parsed on first access
+        source->version = version;
+        for (int i = 0; valid && i < count; i++) {
+            uint64_t offset, size;
+            int teamCount;
+            string name;
+            valid = static_cast<bool>(file >> offset >> size >> teamCount);
+            file.ignore();
+            valid = valid && getline(file, name) && teamCount >= 0;
+            if (!name.empty() && name.back() == '\r') {
+                name.pop_back();
+                crlf = true;
+            }
+            offsets.push_back(offset);
+            sizes.push_back(size);
+            teamCounts.push_back(teamCount);
+            names.push_back(name);
+        }
+        
+        // Offsets count LF line endings. A file whose line endings were
+        // converted to CRLF is read into memory without the CRs and parsed
+        // in full, like older versions.
+        string body;
+        uint64_t bodySize = 0;
+        if (valid) {
+            bodyStart = file.tellg();
+            if (crlf) {
+                body.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+                size_t kept = 0;
+                for (size_t i = 0; i < body.size(); i++) {
+                    if (body[i] != '\r' || i + 1 == body.size() || body[i + 1] != '\n') {
+                        body[kept++] = body[i];
+                    }
+                }
+                body.resize(kept);
+                bodySize = body.size();
+            } else {
+                file.seekg(0, ios::end);
+                bodySize = static_cast<uint64_t>(file.tellg()) - bodyStart;
+            }
+        }
+        
+        // Blocks follow each other and fill the body, as saveData writes them
+        uint64_t blockEnd = 0;
+        for (int i = 0; valid && i < count; i++) {
+            valid = offsets[i] == blockEnd && sizes[i] <= bodySize - offsets[i];
+            blockEnd = offsets[i] + sizes[i];
+        }
+        valid = valid && blockEnd == bodySize;
+        
+        try {
+            for (int i = 0; valid && crlf && i < count; i++) {
+                istringstream block(body.substr(offsets[i], sizes[i]));
+                loaded.emplace_back().loadFromFile(block, version);
+                valid = !(block.fail() && !block.eof()) && loaded.back().getTeamCount() == teamCounts[i];
+            }
+        } catch (const exception&) {
+            valid = false;
+        }
+    } else {
+        try {
+            for (int i = 0; valid && i < count; i++) {
+                loaded.emplace_back().loadFromFile(file, version);
+                // Older files may end without their last optional lines, but
+                // running out before the last championship means a cut-short file
+                valid = !file.bad() && !(file.fail() && (!file.eof() || i + 1 < count));
+            }
+        } catch (const exception&) {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        cerr << "Damaged data file: " << filename << endl;
+        return false;
+    }
+    
+    championships.clear();
+    for (int i = 0; i < count; i++) {
+        if (version >= 5 && !crlf) {
+            championships.emplaceLazy(source, bodyStart + offsets[i], sizes[i], names[i], teamCounts[i]);
+        } else {
+            championships.push_back(move(loaded[i]));
+        }
+    }
+    
+    // Replay changes journaled since the data file was written
+    // A file without a generation (older versions, or written by hand) has
+    // no journal of its own: none is replayed and the next save is a full one
+    int applied = 0, journalVersion = JOURNAL_FORMAT_VERSION;
+    uint64_t journalBytes = generation != 0 ? replayJournal(filename, generation, applied, journalVersion) : 0;
+    if (generation == 0 || (journalBytes > 0 && journalVersion < JOURNAL_FORMAT_VERSION)) {
+        journal.detach();  // Records cannot be appended to an older journal; the next save is a full one
+    } else {
+        journal.attach(filename, generation, journalBytes == 0, journalBytes);
+    }
+    if (hasSeedOverride) {
+        for (size_t i = 0; i < championships.size(); i++) {
+            championships.setSeedAt(i, seedOverride);
+            journal.recordSeed(i, seedOverride);
+        }
+    }
+    
+    currentChampionship = nullptr;
+    cout << "Data loaded successfully from " << filename;
+    if (applied > 0) cout << " (" << applied << " journaled changes replayed)";
+    cout << endl;
+    return true;
+}
+
+// Save all championships to a binary snapshot
+bool saveSnapshot(const string& filename) {
+    SnapshotWriter writer;
+    uint64_t recordsOffset = writer.reserve<SnapshotChampionship>(championships.size());
+    for (size_t i = 0; i < championships.size(); i++) {
+        championships[i].writeSnapshot(writer, recordsOffset + i * sizeof(SnapshotChampionship));
+    }
+    
+    if (!writer.writeTo(filename, championships.size(), recordsOffset)) {
+        cerr << "Error writing snapshot file!\n";
+        return false;
+    }
+    cout << "Snapshot saved successfully to " << filename << endl;
+    return true;
+}
+
+// Load all championships from a binary snapshot
+bool loadSnapshot(const string& filename) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        cerr << "Error opening snapshot file for reading!\n";
+        return false;
+    }
+    
+    const SnapshotHeader* header = file.view<SnapshotHeader>(0);
+    if (!header || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        cerr << "Not a championship snapshot file!\n";
+        return false;
+    }
+    if (header->version > SNAPSHOT_VERSION) {
+        cerr << "Unsupported snapshot version " << header->version << "!\n";
+        return false;
+    }
+    
+    // Version 1 records are shorter; copy each into a zeroed current-layout record
+    size_t recordSize = header->version >= 2 ? sizeof(SnapshotChampionship) : SNAPSHOT_CHAMPIONSHIP_V1_SIZE;
+    const char* records = file.view<char>(header->championshipsOffset, 
+                                          uint64_t(header->championshipCount) * recordSize);
+    if (!records) {
+        cerr << "Corrupt snapshot file!\n";
+        return false;
+    }
+    
+    vector<Championship> loaded(header->championshipCount);
+    for (uint32_t i = 0; i < header->championshipCount; i++) {
+        SnapshotChampionship record = {};
+        memcpy(&record, records + i * recordSize, recordSize);
+        if (!loaded[i].loadFromSnapshot(file, *header, record)) {
+            cerr << "Corrupt snapshot file!\n";
+            return false;
+        }
+        if (hasSeedOverride) loaded[i].setSeed(seedOverride);
+    }
+    
+    championships.clear();
+    for (Championship& champ : loaded) {
+        championships.push_back(move(champ));
+    }
+    currentChampionship = nullptr;
+    journal.detach();  // Journal records refer to the championships of a text data file
+    cout << "Snapshot loaded successfully from " << filename << endl;
+    return true;
+}
+
+// Save all championships to a compact archive
+bool saveArchive(const string& filename) {
+    ofstream file(filename, ios::binary);
+    if (!file) {
+        cerr << "Error opening archive file for writing!\n";
+        return false;
+    }
+    {
+        ArchiveWriter out(file);
+        for (char c : ARCHIVE_MAGIC) {
+            out.byte(c);
+        }
+        out.varint(ARCHIVE_VERSION);
+        out.varint(championships.size());
+        for (size_t i = 0; i < championships.size(); i++) {
+            championships[i].writeArchive(out);
+        }
+    }
+    if (!file.flush()) {
+        cerr << "Error writing archive file!\n";
+        return false;
+    }
+    cout << "Archive saved successfully to " << filename << endl;
+    return true;
+}
+
+// Load all championships from an archive
+bool loadArchive(const string& filename) {
+    ifstream file(filename, ios::binary);
+    if (!file) {
+        cerr << "Error opening archive file for reading!\n";
+        return false;
+    }
+    
+    ArchiveReader in(file);
+    bool magic = true;
+    for (char c : ARCHIVE_MAGIC) {
+        magic = in.byte() == static_cast<uint8_t>(c) && magic;
+    }
+    if (!magic || in.failed()) {
+        cerr << "Not a championship archive file!\n";
+        return false;
+    }
+    uint64_t version = in.varint();
+    if (version > ARCHIVE_VERSION) {
+        cerr << "Unsupported archive version " << version << "!\n";
+        return false;
+    }
+    
+    size_t count = in.count();
+    vector<Championship> loaded(count);
+    for (Championship& champ : loaded) {
+        if (!champ.readArchive(in)) {
+            cerr << "Corrupt archive file!\n";
+            return false;
+        }
+        if (hasSeedOverride) champ.setSeed(seedOverride);
+    }
+    
+    championships.clear();
+    for (Championship& champ : loaded) {
+        championships.push_back(move(champ));
+    }
+    currentChampionship = nullptr;
+    journal.detach();  // Journal records refer to the championships of a text data file
+    cout << "Archive loaded successfully from " << filename << endl;
+    return true;
+}
+
+// Main menu functions
+// Outcome of one championship in a matchday played across all championships
+struct MatchdayResult {
+    string championship;
+    bool played;        // False if the championship has no such stage
+    int matches;
+    int goals;
+    string leader;
+    int leaderPoints;
+};
+
+// Play stage `stage` (0-based) of every championship concurrently. Workers
+// take championships from a shared counter; each championship is touched by
+// one worker only and nothing is printed, so results can be reported in
+// championship order afterwards.
+vector<MatchdayResult> runMatchday(int stage, int threadCount = 0) {
+    vector<MatchdayResult> results(championships.size());
+    if (championships.empty()) {
+        return results;
+    }
+    if (threadCount <= 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    threadCount = min<int>(threadCount, championships.size());
+    
+    // Workers resolve handles, so they never see a championship other than
+    // the one they were given. Championships not parsed yet are parsed here
+    // first, so workers never touch the data file.
+    vector<ChampionshipHandle> handles(championships.size());
+    for (size_t i = 0; i < handles.size(); i++) {
+        handles[i] = championships.handleAt(i);
+        championships.get(handles[i]);
+    }
+    
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < handles.size(); i = next++) {
+            Championship& champ = *championships.get(handles[i]);
+            MatchdayResult& result = results[i];
+            result.championship = champ.getName();
+            result.played = champ.simulateStage(stage);
+            result.matches = champ.getStageMatchesPlayed(stage);
+            result.goals = champ.getStageGoals(stage);
+            result.leaderPoints = 0;
+            if (champ.getTeamCount() > 0) {
+                Team leader = champ.getTeamAtPosition(0);
+                result.leader = leader.name;
+                result.leaderPoints = leader.getPoints();
+            }
+        }
+    };
+    
+    vector<thread> workers;
+    for (int t = 1; t < threadCount; t++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (thread& w : workers) {
+        w.join();
+    }
+    
+    // Journal in championship order once every worker is done
+    for (size_t i = 0; i < championships.size(); i++) {
+        if (results[i].played) {
+            journal.recordStage(i, championships[i], stage);
+        }
+    }
+    return results;
+}
+
+// Print the consolidated summary of a matchday
+void displayMatchdaySummary(int stage, const vector<MatchdayResult>& results, ostream& out = cout) {
+    out << "\n--- Matchday " << stage + 1 << " Summary ---\n";
+    out << left << setw(25) << "Championship" << setw(10) << "Matches" << setw(8) << "Goals"
+        << setw(30) << "Leader" << "Pts" << endl;
+    out << string(76, '-') << endl;
+    int totalMatches = 0, totalGoals = 0;
+    for (const MatchdayResult& result : results) {
+        out << left << setw(25) << truncateString(result.championship, 24);
+        if (!result.played) {
+            out << "no stage " << stage + 1 << endl;
+            continue;
+        }
+        out << setw(10) << result.matches << setw(8) << result.goals
+            << setw(30) << truncateString(result.leader, 29) << result.leaderPoints << endl;
+        totalMatches += result.matches;
+        totalGoals += result.goals;
+    }
+    out << string(76, '-') << endl;
+    out << left << setw(25) << "Total" << setw(10) << totalMatches << totalGoals << endl;
+}
+
+// Move a championship through its undo history (steps < 0 undo, > 0 redo),
+// journaling each step. Returns the number of steps taken.
+int stepStageHistory(Championship& champ, int steps) {
+    int index = championshipIndex(&champ);
+    int taken = 0;
+    for (; steps < 0 && champ.nextUndo(); steps++, taken++) {
+        journal.recordDelta(index, *champ.nextUndo(), true);
+        champ.undoStage();
+    }
+    for (; steps > 0 && champ.nextRedo(); steps--, taken++) {
+        journal.recordDelta(index, *champ.nextRedo(), false);
+        champ.redoStage();
+    }
+    return taken;
+}
+
+void createNewChampionship() {
+    string name;
+    cout << "Enter championship name: ";
+    getline(cin, name);
+    
+    championships.emplace_back(name);
+    currentChampionship = &championships.back();
+    if (hasSeedOverride) {
+        currentChampionship->setSeed(seedOverride);
+    }
+    // The seed is random unless overridden, so replay needs it too
+    journal.recordCreate(name);
+    journal.recordSeed(championshipIndex(currentChampionship), currentChampionship->getSeed());
+    cout << "Championship created successfully!\n";
+}
+
+void selectChampionship() {
+    if (championships.empty()) {
+        cout << "No championships available!\n";
+        return;
+    }
+    
+    cout << "\nAvailable Championships:\n";
+    for (size_t i = 0; i < championships.size(); i++) {
+        cout << i + 1 << ". " << championships.nameAt(i) 
+             << " (" << championships.teamCountAt(i) << " teams)\n";
+    }
+    
+    int choice;
+    cout << "Select championship (0 to cancel): ";
+    cin >> choice;
+    cin.ignore();
+    
+    if (choice == 0) return;
+    
+    if (choice > 0 && choice <= static_cast<int>(championships.size())) {
+        currentChampionship = &championships[choice - 1];
+        cout << "Selected: " << currentChampionship->getName() << endl;
+    } else {
+        cout << "Invalid selection!\n";
+    }
+}
+
+void relegateTeam() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    string name;
+    cout << "Enter team to relegate: ";
+    getline(cin, name);
+    if (currentChampionship->relegateTeam(name)) {
+        journal.recordRelegate(championshipIndex(currentChampionship), name);
+    }
+}
+
+void promoteTeam() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    string name;
+    double value;
+    cout << "Enter team name: ";
+    getline(cin, name);
+    cout << "Enter team value (in millions): ";
+    
+    // Input validation
+    while (!(cin >> value) || value < 0) {
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Invalid value! Please enter a positive number: ";
+    }
+    cin.ignore();
+    
+    Team team(name, value);
+    if (currentChampionship->promoteTeam(team)) {
+        journal.recordPromote(championshipIndex(currentChampionship), team);
+    }
+}
+
+void findTeam() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    string name;
+    cout << "Enter team name (or the start of a word in it): ";
+    getline(cin, name);
+    
+    optional<Team> team = currentChampionship->findTeam(name);
+    vector<Team> matches;
+    if (!team) {
+        matches = currentChampionship->searchTeams(name);
+        if (matches.size() == 1) {
+            team = matches[0];
+        }
+    }
+    if (team) {
+        cout << "\nTeam found:\n";
+        team->display();
+    } else if (!matches.empty()) {
+        cout << "\nMatching teams:\n";
+        for (const Team& match : matches) {
+            cout << "  " << match.name << endl;
+        }
+    } else {
+        cout << "Team not found!\n";
+    }
+}
+
+void generateFixtures() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    if (currentChampionship->getTeamCount() < 2) {
+        cout << "Not enough teams to generate fixtures!\n";
+        return;
+    }
+    
+    currentChampionship->generateFixtures();
+    journal.recordGenerate(championshipIndex(currentChampionship));
+    cout << "Fixtures generated successfully!\n";
+}
+
+void playStage() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    int stage;
+    cout << "Enter stage number to play: ";
+    cin >> stage;
+    cin.ignore();
+    
+    if (currentChampionship->playStage(stage - 1)) {
+        journal.recordStage(championshipIndex(currentChampionship), *currentChampionship, stage - 1);
+        currentChampionship->displayOutlookSummary(currentChampionship->analyzeOutlook());
+    }
+}
+
+void playMatchday() {
+    if (championships.empty()) {
+        cout << "No championships available!\n";
+        return;
+    }
+    
+    int stage;
+    cout << "Enter stage number to play in every championship: ";
+    cin >> stage;
+    cin.ignore();
+    
+    vector<MatchdayResult> results = runMatchday(stage - 1);
+    displayMatchdaySummary(stage - 1, results);
+}
+
+void simulateSeasons() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    if (currentChampionship->getTeamCount() < 2) {
+        cout << "Not enough teams to simulate!\n";
+        return;
+    }
+    if (currentChampionship->getTeamCount() > SIMULATION_MAX_TEAMS) {
+        cout << "Too many teams to simulate (at most " << SIMULATION_MAX_TEAMS << ")!\n";
+        return;
+    }
+    
+    int seasons;
+    cout << "Enter number of seasons to simulate: ";
+    while (!(cin >> seasons) || seasons <= 0) {
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Invalid number! Please enter a positive number: ";
+    }
+    cin.ignore();
+    
+    SimulationResult result = currentChampionship->simulateSeasons(seasons);
+    currentChampionship->displaySimulationReport(result);
+}
+
+void showSeasonOutlook() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    if (currentChampionship->getTeamCount() < 2) {
+        cout << "Not enough teams to analyze!\n";
+        return;
+    }
+    
+    SeasonOutlook outlook = currentChampionship->analyzeOutlook();
+    currentChampionship->displayOutlook(outlook);
+    currentChampionship->displayOutlookSummary(outlook);
+}
+
+void showTeamHistory() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    string name;
+    cout << "Enter team name: ";
+    getline(cin, name);
+    if (!currentChampionship->displayTeamHistory(name)) {
+        cout << "Team not found!\n";
+    }
+}
+
+void showFormTable() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    int window;
+    cout << "Enter number of stages (e.g., 5): ";
+    if (!(cin >> window) || window <= 0) {
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Invalid number of stages!\n";
+        return;
+    }
+    cin.ignore();
+    currentChampionship->displayFormTable(window);
+}
+
+void setRandomSeed() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    cout << "Current seed: " << currentChampionship->getSeed() << endl;
+    cout << "Enter new seed (same seed replays the same results): ";
+    
+    uint64_t newSeed;
+    while (!(cin >> newSeed)) {
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Invalid seed! Please enter a non-negative integer: ";
+    }
+    cin.ignore();
+    
+    currentChampionship->setSeed(newSeed);
+    journal.recordSeed(championshipIndex(currentChampionship), newSeed);
+    cout << "Seed set to " << newSeed << endl;
+}
+
+void resetChampionship() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    char confirm;
+    cout << "Are you sure you want to reset all statistics? (y/n): ";
+    cin >> confirm;
+    cin.ignore();
+    
+    if (tolower(confirm) == 'y') {
+        currentChampionship->resetChampionship();
+        journal.recordReset(championshipIndex(currentChampionship));
+    }
+}
+
+void generateComparisonReport() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    cout << "Metrics: points, value, gd, gf, points-per-value\n";
+    cout << "Enter two metrics to compare (empty for points vs value): ";
+    string line;
+    getline(cin, line);
+    
+    Metric first = Metric::POINTS, second = Metric::VALUE;
+    stringstream ss(line);
+    string firstName, secondName;
+    if (ss >> firstName) {
+        if (!(ss >> secondName) || !parseMetric(firstName, first) || !parseMetric(secondName, second)) {
+            cout << "Invalid metrics!\n";
+            return;
+        }
+    }
+    currentChampionship->generateComparisonReport(first, second);
+}
+
+void setTieBreakRules() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    cout << "Current tie-breaks after points: " << currentChampionship->getTieBreaks().toString() << endl;
+    cout << "Criteria: gd, gf, h2h-points, h2h-gd, h2h-goals, h2h-away (head-to-head away goals)\n";
+    cout << "Enter a comma-separated chain (or 'standard'): ";
+    
+    string text;
+    getline(cin, text);
+    TieBreakRules rules;
+    if (!rules.parse(text)) {
+        cout << "Invalid tie-break chain!\n";
+        return;
+    }
+    if (currentChampionship->setTieBreaks(rules)) {
+        journal.recordTieBreaks(championshipIndex(currentChampionship), rules);
+        cout << "Tie-breaks set to " << rules.toString() << endl;
+    }
+}
+
+void forkChampionship() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    string name;
+    cout << "Enter name for the scenario: ";
+    getline(cin, name);
+    
+    int index = championshipIndex(currentChampionship);
+    championships.push_back(currentChampionship->fork(name));
+    currentChampionship = &championships.back();
+    journal.recordFork(index, name);
+    cout << "Forked " << championships[index].getName() << " into " << name << " (now selected)\n";
+}
+
+void undoRedoStages(bool undo) {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    int available = undo ? currentChampionship->getUndoCount() : currentChampionship->getRedoCount();
+    if (available == 0) {
+        cout << (undo ? "Nothing to undo!\n" : "Nothing to redo!\n");
+        return;
+    }
+    
+    int count;
+    cout << "Stages to " << (undo ? "undo" : "redo") << " (1-" << available << "): ";
+    cin >> count;
+    cin.ignore();
+    if (count < 1 || count > available) {
+        cout << "Invalid number of stages!\n";
+        return;
+    }
+    
+    stepStageHistory(*currentChampionship, undo ? -count : count);
+    cout << count << " stage(s) " << (undo ? "undone" : "redone") << ". Stages completed: "
+         << currentChampionship->getStagesCompleted() << endl;
+}
+
+void restoreToStage() {
+    if (!currentChampionship) {
+        cout << "No championship selected!\n";
+        return;
+    }
+    
+    int stage;
+    cout << "Restore to the state after stage (0 for before the first): ";
+    cin >> stage;
+    cin.ignore();
+    
+    int steps;
+    if (!currentChampionship->stepsToStage(stage, steps)) {
+        cout << "Stage " << stage << " is not in the undo history!\n";
+        return;
+    }
+    stepStageHistory(*currentChampionship, steps);
+    cout << "Restored to the state after stage " << stage << ".\n";
+}
+
+// ===== Command parsing =====
+// Shared by batch mode, script files and the query server.
+
+// Parse a strictly numeric argument
+bool parseBatchInt(const string& text, int& value) {
+    try {
+        size_t used;
+        value = stoi(text, &used);
+        return used == text.size();
+    } catch (const exception&) {
+        return false;
+    }
+}
+
+// Parse a seed: decimal digits only, in range for 64 bits
+bool parseBatchSeed(const string& text, uint64_t& value) {
+    const char* end = text.data() + text.size();
+    from_chars_result parsed = from_chars(text.data(), end, value);
+    return !text.empty() && parsed.ec == errc() && parsed.ptr == end;
+}
+
+// Split a script line into words, honouring double quotes
+vector<string> splitScriptLine(const string& line) {
+    vector<string> words;
+    string word;
+    bool inQuotes = false, hasWord = false;
+    for (char c : line) {
+        if (c == '"') {
+            inQuotes = !inQuotes;
+            hasWord = true;
+        } else if (!inQuotes && c == '#') {
+            break;
+        } else if (!inQuotes && isspace(static_cast<unsigned char>(c))) {
+            if (hasWord) words.push_back(word);
+            word.clear();
+            hasWord = false;
+        } else {
+            word += c;
+            hasWord = true;
+        }
+    }
+    if (hasWord) words.push_back(word);
+    return words;
+}
+
+// ===== Query server =====
+// `serve <socket>` answers read-only queries on a Unix domain socket while
+// the championships keep changing. After every change (and after every
+// stage played by play-stage/play-season) the writer publishes a snapshot:
+// copies of the championships made the way fork() makes them, so they share
+// names, fixtures and results and cost O(teams + stages). Championships the
+// writer has not parsed yet are published as the location of their block and
+// parsed by the server thread when a query first needs them. One server thread
+// polls every connection and answers each query from the newest snapshot;
+// the handoff is a single atomic exchange, so neither side ever waits.
+//
+// Protocol: one query per line (words split like script lines). Replies are
+// "OK <snapshot> <bytes>\n" followed by exactly <bytes> bytes, or
+// "ERR <message>\n".
+
+const char* const SERVER_DEFAULT_SOCKET = "championship.sock";
+const int SERVER_POLL_MS = 100;                  // How often the server checks for shutdown
+const size_t SERVER_MAX_CLIENTS = 256;
+const size_t SERVER_MAX_LINE = 4096;
+const size_t SERVER_MAX_PENDING = 1 << 24;       // Unsent reply bytes before a client is dropped
+
+struct ServerCommand {
+    const char* name;
+    int minArgs;
+    int maxArgs;
+    const char* usage;
+};
+
+const ServerCommand SERVER_COMMANDS[] = {
+    {"championships", 0, 0, "championships              List the championships (* marks the selected one)"},
+    {"use", 1, 1, "use <name|number>          Query another championship on this connection"},
+    {"standings", 0, 1, "standings [table|csv|json] Print the standings"},
+    {"position", 1, 2, "position <team> [k]        Print a team's position (after stage k)"},
+    {"fixtures", 1, 1, "fixtures <k>               Print the fixtures and results of stage k"},
+    {"compare", 2, 2, "compare <metric> <metric>  Compare two rankings (points, value, gd, gf, points-per-value)"},
+    {"help", 0, 0, "help                       List the queries"},
+    {"quit", 0, 0, "quit                       Close the connection"},
+};
+
+const ServerCommand* findServerCommand(const string& name) {
+    for (const ServerCommand& command : SERVER_COMMANDS) {
+        if (name == command.name) return &command;
+    }
+    return nullptr;
+}
+
+// The championships as they were at one point. Never changed once published,
+// except that the server thread fills in the championships it parses.
+struct ServerSnapshot {
+    uint64_t version = 0;
+    vector<shared_ptr<const Championship>> championships;   // Registry order (null: not parsed)
+    vector<shared_ptr<const LazyChampionship>> unparsed;    // Block of each null championship
+    int selected = -1;                                      // Selected by the writer
+};
+
+// Single-slot handoff from one writer thread to one reader thread. The
+// writer swaps in each new snapshot and frees the previous one if the
+// reader never took it; the reader takes the newest and owns it from then on.
+class SnapshotMailbox {
+private:
+    atomic<ServerSnapshot*> slot;
+
+public:
+    SnapshotMailbox() : slot(nullptr) {}
+    SnapshotMailbox(const SnapshotMailbox&) = delete;
+    SnapshotMailbox& operator=(const SnapshotMailbox&) = delete;
+    ~SnapshotMailbox() { delete slot.exchange(nullptr); }
+
+    void publish(unique_ptr<ServerSnapshot> snapshot) {
+        delete slot.exchange(snapshot.release(), memory_order_acq_rel);
+    }
+
+    // The snapshot published since the last take (null if there is none)
+    unique_ptr<ServerSnapshot> take() {
+        return unique_ptr<ServerSnapshot>(slot.exchange(nullptr, memory_order_acq_rel));
+    }
+};
+
+class QueryServer {
+private:
+    struct Client {
+        int fd;
+        string input;          // Received bytes after the last complete line
+        string output;         // Replies not sent yet
+        size_t sent = 0;       // Bytes of output already sent
+        string championship;   // Chosen with `use` (empty: the writer's selection)
+        bool closing = false;  // Close once the replies are sent
+
+        explicit Client(int socket) : fd(socket) {}
+    };
+
+    string socketPath;
+    int listenFd;
+    thread worker;
+    atomic<bool> stopping;
+    SnapshotMailbox mailbox;
+
+    // Writer side: the copies in the last published snapshot
+    vector<shared_ptr<const Championship>> published;
+    vector<shared_ptr<const LazyChampionship>> publishedUnparsed;
+    uint64_t version;
+
+    // Server thread side
+    unique_ptr<ServerSnapshot> snapshot;
+    ostringstream text;
+    string line;
+
+    shared_ptr<const Championship> copyOf(size_t index) {
+        const Championship& champ = championships[index];
+        return make_shared<const Championship>(champ.fork(champ.getName()));
+    }
+
+    // Unparsed block of a championship, reused from the last snapshot while
+    // the registry still holds the same block (so the server thread keeps
+    // what it parsed from it)
+    shared_ptr<const LazyChampionship> unparsedOf(size_t index) {
+        const LazyChampionship& lazy = championships.lazyAt(index);
+        if (index < publishedUnparsed.size() && publishedUnparsed[index]) {
+            const LazyChampionship& previous = *publishedUnparsed[index];
+            if (previous.source == lazy.source && previous.offset == lazy.offset && previous.seed == lazy.seed) {
+                return publishedUnparsed[index];
+            }
+        }
+        return make_shared<const LazyChampionship>(lazy);
+    }
+
+    // Take the newest snapshot, carrying over the championships this thread
+    // already parsed from blocks it still lists
+    void takeLatest() {
+        unique_ptr<ServerSnapshot> latest = mailbox.take();
+        if (!latest) return;
+        for (size_t i = 0; snapshot && i < latest->championships.size() && i < snapshot->championships.size(); i++) {
+            if (!latest->championships[i] && latest->unparsed[i] == snapshot->unparsed[i]) {
+                latest->championships[i] = snapshot->championships[i];
+            }
+        }
+        snapshot = move(latest);
+    }
+
+    string nameAt(size_t index) const {
+        const shared_ptr<const Championship>& champ = snapshot->championships[index];
+        return champ ? champ->getName() : snapshot->unparsed[index]->name;
+    }
+
+    // A championship of the snapshot, parsing it first if needed
+    const Championship* championshipAt(size_t index) {
+        shared_ptr<const Championship>& champ = snapshot->championships[index];
+        if (!champ) {
+            shared_ptr<Championship> parsed = make_shared<Championship>();
+            snapshot->unparsed[index]->parse(*parsed, LazyReader::SERVER);
+            champ = move(parsed);
+        }
+        return champ.get();
+    }
+
+    // Championship a client's queries go to (null with the reason in error)
+    const Championship* championshipFor(const Client& client, string& error) {
+        if (client.championship.empty()) {
+            if (snapshot->selected < 0) error = "No championship selected";
+            return snapshot->selected < 0 ? nullptr : championshipAt(snapshot->selected);
+        }
+        for (size_t i = 0; i < snapshot->championships.size(); i++) {
+            if (nameAt(i) == client.championship) return championshipAt(i);
+        }
+        error = "Championship not found: " + client.championship;
+        return nullptr;
+    }
+
+    // Answer one query from the current snapshot into text (false with the
+    // reason in error if it cannot be answered)
+    bool query(Client& client, const vector<string>& words, string& error) {
+        const string& cmd = words[0];
+        const ServerCommand* command = findServerCommand(cmd);
+        if (!command) {
+            error = "Unknown command: " + cmd;
+            return false;
+        }
+        int argCount = static_cast<int>(words.size()) - 1;
+        if (argCount < command->minArgs || argCount > command->maxArgs) {
+            error = string("Usage: ") + command->usage;
+            return false;
+        }
+        
+        if (cmd == "help") {
+            for (const ServerCommand& entry : SERVER_COMMANDS) {
+                text << entry.usage << '\n';
+            }
+            return true;
+        }
+        if (cmd == "quit") {
+            client.closing = true;
+            return true;
+        }
+        if (cmd == "championships") {
+            for (size_t i = 0; i < snapshot->championships.size(); i++) {
+                const Championship* champ = snapshot->championships[i].get();
+                text << i + 1 << ". " << nameAt(i) << " (";
+                if (champ) {
+                    text << champ->getTeamCount() << " teams, stage "
+                         << champ->getStagesCompleted() << '/' << champ->getTotalStages() << ')';
+                } else {
+                    text << snapshot->unparsed[i]->teamCount << " teams, not loaded yet)";
+                }
+                text << (static_cast<int>(i) == snapshot->selected ? " *" : "") << '\n';
+            }
+            return true;
+        }
+        if (cmd == "use") {
+            int number;
+            for (size_t i = 0; i < snapshot->championships.size(); i++) {
+                string name = nameAt(i);
+                if (name == words[1] || (parseBatchInt(words[1], number) && number == static_cast<int>(i) + 1)) {
+                    client.championship = name;
+                    text << "Using " << name << '\n';
+                    return true;
+                }
+            }
+            error = "Championship not found: " + words[1];
+            return false;
+        }
+        
+        const Championship* champ = championshipFor(client, error);
+        if (!champ) return false;
+        
+        if (cmd == "standings") {
+            StandingsFormat format = StandingsFormat::TABLE;
+            if (argCount == 1 && !parseStandingsFormat(words[1], format)) {
+                error = "Invalid format: " + words[1];
+                return false;
+            }
+            text << champ->renderStandings(format);
+        } else if (cmd == "position") {
+            int stage = 0;
+            if (argCount == 2 && !parseBatchInt(words[2], stage)) {
+                error = "Invalid stage: " + words[2];
+                return false;
+            }
+            int position = argCount == 2 ? champ->getTeamPositionAt(words[1], stage)
+                                         : champ->getTeamPosition(words[1]);
+            if (position == -1) {
+                error = argCount == 2 ? "No position for " + words[1] + " after stage " + words[2]
+                                      : "Team not found: " + words[1];
+                return false;
+            }
+            text << words[1] << (argCount == 2 ? " was" : " is") << " in position #" << position;
+            if (argCount == 2) text << " after stage " << stage;
+            text << '\n';
+        } else if (cmd == "fixtures") {
+            int stage;
+            if (!parseBatchInt(words[1], stage) || stage < 1 || stage > champ->getTotalStages()) {
+                error = "Stage out of range (1-" + to_string(champ->getTotalStages()) + ")";
+                return false;
+            }
+            champ->displayFixtures(stage - 1, text);
+        } else if (cmd == "compare") {
+            Metric first, second;
+            if (!parseMetric(words[1], first) || !parseMetric(words[2], second)) {
+                error = "Invalid metrics: " + words[1] + " " + words[2];
+                return false;
+            }
+            champ->generateComparisonReport(first, second, text);
+        }
+        return true;
+    }
+
+    // Answer a query line, appending the reply to the client's output
+    void answer(Client& client) {
+        vector<string> words = splitScriptLine(line);
+        if (words.empty()) return;
+        takeLatest();
+        
+        text.str("");
+        string error;
+        if (query(client, words, error)) {
+            string reply = text.str();
+            client.output.append("OK ").append(to_string(snapshot->version)).append(" ")
+                         .append(to_string(reply.size())).append("\n").append(reply);
+        } else {
+            client.output.append("ERR ").append(error).append("\n");
+        }
+    }
+
+#ifndef _WIN32
+    // Read what a client sent and answer its complete lines (false if the
+    // connection failed). A client that finished sending is closed once
+    // the replies to its queries are sent.
+    bool receive(Client& client) {
+        char buffer[1 << 14];
+        ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (received == 0) {
+            client.closing = true;
+            return true;
+        }
+        if (received < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        client.input.append(buffer, received);
+        
+        size_t start = 0, end;
+        while (!client.closing && (end = client.input.find('\n', start)) != string::npos) {
+            line.assign(client.input, start, end - start);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.size() > SERVER_MAX_LINE) break;
+            answer(client);
+            start = end + 1;
+        }
+        client.input.erase(0, start);
+        if (!client.closing && client.input.size() > SERVER_MAX_LINE) {
+            client.output.append("ERR Query too long\n");
+            client.closing = true;
+        }
+        return true;
+    }
+
+    // Send as much pending output as the socket takes (false once the client
+    // should be dropped)
+    bool flush(Client& client) {
+        while (client.sent < client.output.size()) {
+            ssize_t written = send(client.fd, client.output.data() + client.sent,
+                                   client.output.size() - client.sent, 0);
+            if (written < 0) {
+                bool retry = errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+                return retry && client.output.size() - client.sent <= SERVER_MAX_PENDING;
+            }
+            client.sent += written;
+        }
+        client.output.clear();
+        client.sent = 0;
+        return !client.closing;
+    }
+
+    // Accept every waiting connection
+    void acceptClients(vector<Client>& clients) {
+        int fd;
+        while ((fd = accept(listenFd, nullptr, nullptr)) >= 0) {
+            if (clients.size() >= SERVER_MAX_CLIENTS) {
+                close(fd);
+                continue;
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            clients.emplace_back(fd);
+        }
+    }
+
+    // Server thread: poll the listening socket and every connection until stopped
+    void run() {
+        vector<Client> clients;
+        vector<pollfd> polled;
+        while (!stopping.load(memory_order_acquire)) {
+            polled.assign(1, pollfd{listenFd, POLLIN, 0});
+            for (const Client& client : clients) {
+                short events = client.closing ? 0 : POLLIN;
+                if (client.sent < client.output.size()) events |= POLLOUT;
+                polled.push_back(pollfd{client.fd, events, 0});
+            }
+            if (poll(polled.data(), polled.size(), SERVER_POLL_MS) < 0 && errno != EINTR) {
+                break;
+            }
+            
+            for (size_t i = 0; i < clients.size(); i++) {
+                Client& client = clients[i];
+                short events = polled[i + 1].revents;
+                bool open = true;
+                if (events & (POLLIN | POLLHUP | POLLERR)) {
+                    open = receive(client);
+                }
+                if (open) {
+                    open = flush(client);
+                }
+                if (!open) {
+                    close(client.fd);
+                    client.fd = -1;
+                }
+            }
+            clients.erase(remove_if(clients.begin(), clients.end(),
+                                    [](const Client& client) { return client.fd == -1; }),
+                          clients.end());
+            if (polled[0].revents & POLLIN) {
+                acceptClients(clients);
+            }
+        }
+        for (const Client& client : clients) {
+            close(client.fd);
+        }
+    }
+#endif
+
+public:
+    QueryServer() : listenFd(-1), stopping(false), version(0) {}
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+    ~QueryServer() { stop(); }
+
+    bool running() const { return listenFd != -1; }
+
+    // Listen on a Unix domain socket and start answering queries
+    bool start(const string& path) {
+        if (running()) {
+            cerr << "The query server is already running on " << socketPath << endl;
+            return false;
+        }
+#ifdef _WIN32
+        cerr << "The query server needs Unix domain sockets, which this build does not support\n";
+        return false;
+#else
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            cerr << "Invalid socket path: " << path << endl;
+            return false;
+        }
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        
+        // A socket left behind by a server that is gone is replaced; a live
+        // server or any other kind of file is left alone
+        struct stat info;
+        if (lstat(path.c_str(), &info) == 0) {
+            int probe = S_ISSOCK(info.st_mode) ? socket(AF_UNIX, SOCK_STREAM, 0) : -1;
+            bool live = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+            if (probe >= 0) close(probe);
+            if (!S_ISSOCK(info.st_mode) || live) {
+                cerr << "Cannot listen on " << path << ": the path is in use\n";
+                return false;
+            }
+            unlink(path.c_str());
+        }
+        
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(fd, SOMAXCONN) != 0) {
+            cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        signal(SIGPIPE, SIG_IGN);  // A client hanging up must not end the process
+        
+        socketPath = path;
+        listenFd = fd;
+        stopping.store(false);
+        publish();
+        worker = thread(&QueryServer::run, this);
+        cout << "Answering queries on " << path << endl;
+        return true;
+#endif
+    }
+
+    // Close every connection and remove the socket
+    void stop() {
+        if (!running()) return;
+        stopping.store(true, memory_order_release);
+        worker.join();
+#ifndef _WIN32
+        close(listenFd);
+        unlink(socketPath.c_str());
+#endif
+        listenFd = -1;
+        snapshot.reset();
+        mailbox.take();
+        published.clear();
+        publishedUnparsed.clear();
+    }
+
+    // Publish the championships as they are now (index: only that one
+    // changed since the last publication). Championships that are not parsed
+    // yet are published unparsed. Called by the writer thread only.
+    void publish(int index = -1) {
+        if (!running()) return;
+        if (index < 0 || published.size() != championships.size()) {
+            vector<shared_ptr<const LazyChampionship>> unparsed(championships.size());
+            published.resize(championships.size());
+            for (size_t i = 0; i < championships.size(); i++) {
+                if (championships.isParsed(i)) {
+                    published[i] = copyOf(i);
+                } else {
+                    published[i].reset();
+                    unparsed[i] = unparsedOf(i);
+                }
+            }
+            publishedUnparsed = move(unparsed);
+        } else {
+            published[index] = copyOf(index);
+            publishedUnparsed[index].reset();
+        }
+        
+        unique_ptr<ServerSnapshot> next(new ServerSnapshot());
+        next->version = ++version;
+        next->championships = published;
+        next->unparsed = publishedUnparsed;
+        next->selected = championshipIndex(currentChampionship);
+        mailbox.publish(move(next));
+    }
+};
+
+QueryServer queryServer;
+
+volatile sig_atomic_t serverInterrupted = 0;
+
+void onServerInterrupt(int) {
+    serverInterrupted = 1;
+}
+
+// Keep answering queries until SIGINT or SIGTERM, then shut the server down
+void serveUntilInterrupted() {
+    signal(SIGINT, onServerInterrupt);
+    signal(SIGTERM, onServerInterrupt);
+    while (!serverInterrupted) {
+        this_thread::sleep_for(chrono::milliseconds(SERVER_POLL_MS));
+    }
+    queryServer.stop();
+}
+
+void startQueryServer() {
+    string path;
+    cout << "Enter socket path (default " << SERVER_DEFAULT_SOCKET << "): ";
+    getline(cin, path);
+    queryServer.start(path.empty() ? SERVER_DEFAULT_SOCKET : path);
+}
+
+// ===== Benchmark suite =====
+// Times the core championship operations on synthetic leagues and reports
+// ns/op, heap allocations/op and throughput. The outlook is skipped for the
+// largest leagues, where the remaining fixtures alone run into the billions.
+
+const int BENCH_LEAGUE_SIZES[] = {16, 64, 256, 1024, 4096, 10000, 100000};
+const double BENCH_MIN_SECONDS = 0.25;
+// The outlook walks every remaining match, which is quadratic in the league size
+const int BENCH_MAX_OUTLOOK_TEAMS = 4096;
+
+// Results fed here cannot be optimized away
+volatile uintptr_t benchmarkSink = 0;
+
+struct BenchmarkResult {
+    string name;
+    int teams;
+    double nsPerOp;
+    double allocsPerOp;     // negative when allocations are not counted
+    double itemsPerSecond;
+    string unit;
+};
+
+// Run op repeatedly for at least BENCH_MIN_SECONDS (after one warm-up call)
+template <typename Operation>
+BenchmarkResult measureBenchmark(const string& name, int teams, double itemsPerOp,
+                                 const string& unit, Operation op) {
+    typedef chrono::steady_clock Clock;
+    op();
+    
+    long long iterations = 0;
+    long long batch = 1;
+#ifdef FC_COUNT_ALLOCS
+    uint64_t allocationsBefore = heapAllocations.load();
+#endif
+    Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    while (elapsed < BENCH_MIN_SECONDS) {
+        for (long long i = 0; i < batch; i++) {
+            op();
+        }
+        iterations += batch;
+        elapsed = chrono::duration<double>(Clock::now() - start).count();
+        batch = min(batch * 2, 1LL << 20);
+    }
+#ifdef FC_COUNT_ALLOCS
+    uint64_t allocations = heapAllocations.load() - allocationsBefore;
+#endif
+    
+    BenchmarkResult result;
+    result.name = name;
+    result.teams = teams;
+    result.nsPerOp = elapsed * 1e9 / iterations;
+#ifdef FC_COUNT_ALLOCS
+    result.allocsPerOp = static_cast<double>(allocations) / iterations;
+#else
+    result.allocsPerOp = -1.0;
+#endif
+    result.itemsPerSecond = itemsPerOp * iterations / elapsed;
+    result.unit = unit;
+    return result;
+}
+
+// Synthetic league with deterministic names and values
+Championship makeBenchmarkLeague(int teamCount) {
+    Championship champ("Benchmark League");
+    champ.setSeed(12345);
+    vector<Team> teams;
+    for (int i = 0; i < teamCount; i++) {
+        double value = 10.0 + (MatchRng::mix(i) % 9000) / 100.0;
+        Team team("Benchmark Team " + to_string(i + 1), value);
+        
+        // Spread of plausible mid-season records so ranking has real work
+        uint64_t r = MatchRng::mix(teamCount + i);
+        team.wins = r % 20;
+        team.draws = (r >> 8) % 10;
+        team.losses = (r >> 16) % 20;
+        team.goalsFor = team.wins * 2 + (r >> 24) % 15;
+        team.goalsAgainst = team.losses * 2 + (r >> 32) % 15;
+        teams.push_back(team);
+    }
+    champ.addTeams(teams);
+    return champ;
+}
+
+void printBenchmarkResult(ostream& out, const BenchmarkResult& result) {
+    out << left << setw(24) << result.name
+        << right << setw(8) << result.teams
+        << setw(16) << fixed << setprecision(1) << result.nsPerOp;
+    if (result.allocsPerOp < 0) {
+        out << setw(14) << "-";
+    } else {
+        out << setw(14) << setprecision(2) << result.allocsPerOp;
     }
+    out << setw(16) << setprecision(0) << result.itemsPerSecond
+        << ' ' << result.unit << '\n';
+    out.unsetf(ios::fixed);
+    out << setprecision(6) << flush;
+}
 
-    // Compare actual standings vs value-based standings
-    void generateComparisonReport() {
-        vector<Team> pointsSorted = teams;
-        vector<Team> valueSorted = teams;
+// Run every benchmark for the standard league sizes up to maxTeams
+void runBenchmarks(int maxTeams, ostream& report) {
+    // The export benchmark writes to a uniquely named file in the temp directory
+    error_code tempError;
+    const string csvFile = (filesystem::temp_directory_path(tempError) /
+                            ("benchmark_standings_" + to_string(MatchRng::randomSeed()) + ".csv")).string();
+    NullBuffer nullBuffer;
+    ostream nullStream(&nullBuffer);
+    ostream out(report.rdbuf());  // Keeps reporting even when report is cout
+    streambuf* console = cout.rdbuf();
+    cout.rdbuf(&nullBuffer);  // Silence progress messages from the operations
+    
+    out << left << setw(24) << "Benchmark" << right << setw(8) << "Teams"
+        << setw(16) << "ns/op" << setw(14) << "allocs/op" << setw(16) << "throughput" << '\n';
+    out << string(78, '-') << '\n';
+    
+    for (int teamCount : BENCH_LEAGUE_SIZES) {
+        if (teamCount > maxTeams) break;
+        Championship champ = makeBenchmarkLeague(teamCount);
         
-        sort(pointsSorted.begin(), pointsSorted.end(), 
-            [](const Team& a, const Team& b) {
-                return a.getPoints() > b.getPoints();
-            });
+        double matches = static_cast<double>(teamCount / 2) * (teamCount - 1 + teamCount % 2) * 2;
+        printBenchmarkResult(out, measureBenchmark("generateFixtures", teamCount, matches, "matches/s",
+            [&]() { champ.generateFixtures(); }));
         
-        sort(valueSorted.begin(), valueSorted.end(), 
-            [](const Team& a, const Team& b) {
-                return a.value > b.value;
-            });
+        int stage = 0;
+        int stages = champ.getTotalStages();
+        printBenchmarkResult(out, measureBenchmark("playStage", teamCount, teamCount / 2, "matches/s",
+            [&]() { champ.playStage(stage++ % stages, false); }));
         
-        const int nameWidth = 50;
+        printBenchmarkResult(out, measureBenchmark("fork", teamCount, 1, "forks/s",
+            [&]() {
+                Championship scenario = champ.fork("Scenario");
+                benchmarkSink = scenario.getTeamCount();
+            }));
         
-        cout << "\n--- Performance Comparison Report ---\n";
-        cout << left << setw(nameWidth) << "Team"
-             << setw(10) << "Pts Pos"
-             << setw(10) << "Val Pos"
-             << "Diff\n";
-        cout << string(nameWidth + 30, '-') << endl;
+        // What the writer pays per stage while the query server runs
+        SnapshotMailbox mailbox;
+        printBenchmarkResult(out, measureBenchmark("publishSnapshot", teamCount, 1, "snapshots/s",
+            [&]() {
+                unique_ptr<ServerSnapshot> snapshot(new ServerSnapshot());
+                snapshot->championships.push_back(make_shared<const Championship>(champ.fork(champ.getName())));
+                mailbox.publish(move(snapshot));
+                benchmarkSink = mailbox.take() != nullptr;
+            }));
         
-        for (const Team& team : teams) {
-            int pointsPos = -1, valuePos = -1;
-            
-            for (size_t i = 0; i < pointsSorted.size(); i++) {
-                if (pointsSorted[i].name == team.name) pointsPos = i + 1;
-                if (valueSorted[i].name == team.name) valuePos = i + 1;
-            }
-            
-            cout << left << setw(nameWidth) << truncateString(team.name, nameWidth)
-                 << setw(10) << pointsPos
-                 << setw(10) << valuePos
-                 << (pointsPos - valuePos) << endl;
-        }
-    }
-
-    // Reset all statistics
-    void resetChampionship() {
-        for (Team& team : teams) {
-            team.resetStats();
-        }
-        stagesCompleted = 0;
-        for (auto& stage : fixtures) {
-            for (Match& match : stage) {
-                match.homeGoals = 0;
-                match.awayGoals = 0;
-                match.played = false;
+        if (teamCount <= BENCH_MAX_OUTLOOK_TEAMS) {
+            // Halfway through a season, so there is a race left to analyze
+            Championship season = makeBenchmarkLeague(teamCount);
+            season.generateFixtures();
+            for (int s = 0; s < season.getTotalStages() / 2; s++) {
+                season.simulateStage(s);
             }
+            int remaining = season.analyzeOutlook().remainingMatches;
+            printBenchmarkResult(out, measureBenchmark("analyzeOutlook", teamCount, remaining, "matches/s",
+                [&]() { benchmarkSink = season.analyzeOutlook().size(); }));
         }
-        cout << "Championship statistics reset!\n";
-    }
-
-    // Getter for championship name
-    string getName() const { return name; }
-
-    // Get number of teams
-    int getTeamCount() const { return teams.size(); }
-
-    // Save championship data to file
-    void saveToFile(ofstream& file) {
-        file << name << '\n';
-        file << teams.size() << ' ' << stagesCompleted << ' ' << totalStages << '\n';
-        for (const Team& team : teams) {
-            file << team.name << ',' << team.value << ',' 
-                 << team.wins << ',' << team.draws << ',' 
-                 << team.losses << ',' << team.goalsFor << ',' 
-                 << team.goalsAgainst << '\n';
-        }
-        
-        // Save fixtures
-        file << fixtures.size() << '\n';
-        for (const auto& stage : fixtures) {
-            file << stage.size() << '\n';
-            for (const Match& match : stage) {
-                file << match.homeTeam << ',' << match.awayTeam << ','
-                     << match.homeGoals << ',' << match.awayGoals << ','
-                     << match.played << '\n';
-            }
+        
+        printBenchmarkResult(out, measureBenchmark("recomputeStandings", teamCount, teamCount, "teams/s",
+            [&]() { champ.recomputeStandings(); }));
+        
+        if (teamCount <= HEAD_TO_HEAD_MAX_TEAMS) {
+            Championship headToHead = champ.fork("Head-to-head");
+            TieBreakRules rules;
+            rules.parse("h2h-points,h2h-gd,gd,gf");
+            headToHead.setTieBreaks(rules);
+            printBenchmarkResult(out, measureBenchmark("recomputeStandings/h2h", teamCount, teamCount, "teams/s",
+                [&]() { headToHead.recomputeStandings(); }));
         }
-    }
-
-    // Load championship data from file
-    void loadFromFile(ifstream& file) {
-        getline(file, name);
         
-        int teamCount;
-        file >> teamCount >> stagesCompleted >> totalStages;
-        file.ignore();  // Skip newline
+        printBenchmarkResult(out, measureBenchmark("compareMetrics", teamCount, teamCount, "teams/s",
+            [&]() {
+                benchmarkSink = champ.compareMetrics(Metric::POINTS_PER_VALUE, Metric::GOAL_DIFFERENCE).kendall > 0;
+            }));
         
-        teams.clear();
-        for (int i = 0; i < teamCount; i++) {
-            string line;
-            getline(file, line);
-            stringstream ss(line);
-            string token;
-            
-            vector<string> tokens;
-            while (getline(ss, token, ',')) {
-                tokens.push_back(token);
-            }
-            
-            if (tokens.size() == 7) {
-                Team team(tokens[0], stod(tokens[1]));
-                team.wins = stoi(tokens[2]);
-                team.draws = stoi(tokens[3]);
-                team.losses = stoi(tokens[4]);
-                team.goalsFor = stoi(tokens[5]);
-                team.goalsAgainst = stoi(tokens[6]);
-                teams.push_back(team);
-            }
+        printBenchmarkResult(out, measureBenchmark("displayStandings", teamCount, teamCount, "rows/s",
+            [&]() { champ.displayStandings(nullStream); }));
+        
+        printBenchmarkResult(out, measureBenchmark("exportStandingsToCSV", teamCount, teamCount, "rows/s",
+            [&]() { champ.exportStandingsToCSV(csvFile); }));
+        
+        printBenchmarkResult(out, measureBenchmark("renderStandings/json", teamCount, teamCount, "rows/s",
+            [&]() { benchmarkSink = champ.renderStandings(StandingsFormat::JSON).size(); }));
+        
+        stringstream saved;
+        champ.saveToFile(saved);
+        string savedText = saved.str();
+        printBenchmarkResult(out, measureBenchmark("saveToFile", teamCount, savedText.size() / 1e6, "MB/s",
+            [&]() {
+                stringstream buffer;
+                champ.saveToFile(buffer);
+            }));
+        
+        printBenchmarkResult(out, measureBenchmark("loadFromFile", teamCount, savedText.size() / 1e6, "MB/s",
+            [&]() {
+                stringstream buffer(savedText);
+                Championship loaded;
+                loaded.loadFromFile(buffer, DATA_FORMAT_VERSION);
+            }));
+        
+        stringstream archived;
+        {
+            ArchiveWriter writer(archived);
+            champ.writeArchive(writer);
         }
+        string archivedBytes = archived.str();
+        printBenchmarkResult(out, measureBenchmark("saveArchive", teamCount, archivedBytes.size() / 1e6, "MB/s",
+            [&]() {
+                stringstream buffer;
+                ArchiveWriter writer(buffer);
+                champ.writeArchive(writer);
+            }));
         
-        // Load fixtures
-        int stageCount;
-        file >> stageCount;
-        file.ignore();
+        printBenchmarkResult(out, measureBenchmark("loadArchive", teamCount, archivedBytes.size() / 1e6, "MB/s",
+            [&]() {
+                stringstream buffer(archivedBytes);
+                ArchiveReader reader(buffer);
+                Championship loaded;
+                benchmarkSink = loaded.readArchive(reader);
+            }));
         
-        fixtures.clear();
-        for (int i = 0; i < stageCount; i++) {
-            int matchCount;
-            file >> matchCount;
-            file.ignore();
-            
-            vector<Match> stageMatches;
-            for (int j = 0; j < matchCount; j++) {
-                string line;
-                getline(file, line);
-                stringstream ss(line);
-                vector<string> tokens;
-                string token;
-                
-                while (getline(ss, token, ',')) {
-                    tokens.push_back(token);
-                }
-                
-                if (tokens.size() == 5) {
-                    Match match(tokens[0], tokens[1]);
-                    match.homeGoals = stoi(tokens[2]);
-                    match.awayGoals = stoi(tokens[3]);
-                    match.played = tokens[4] == "1";
-                    stageMatches.push_back(match);
-                }
-            }
-            fixtures.push_back(stageMatches);
+        // Case-changed lookups of names spread across the league
+        vector<string> queries;
+        for (int i = 0; i < 64; i++) {
+            string query = "BENCHMARK team " + to_string(1 + MatchRng::mix(i) % teamCount);
+            queries.push_back(query);
+        }
+        size_t next = 0;
+        printBenchmarkResult(out, measureBenchmark("findTeam", teamCount, 1, "lookups/s",
+            [&]() {
+                benchmarkSink = champ.findTeam(queries[next++ % queries.size()]).has_value();
+            }));
+        
+        // Word-prefix searches ("team 12" matches teams 12, 120-129, ...)
+        vector<string> prefixes;
+        for (int i = 0; i < 64; i++) {
+            prefixes.push_back(to_string(1 + MatchRng::mix(i) % teamCount).substr(0, 3));
         }
+        printBenchmarkResult(out, measureBenchmark("searchTeams", teamCount, 1, "lookups/s",
+            [&]() {
+                benchmarkSink = champ.searchTeams(prefixes[next++ % prefixes.size()]).size();
+            }));
     }
+    
+    cout.rdbuf(console);
+    remove(csvFile.c_str());
+}
+
+// ===== Batch mode =====
+// Commands run without prompts. Progress messages from the championship code
+// are discarded; only query commands (standings, position, report, simulate)
+// write to stdout and failures go to stderr.
+
+struct BatchCommand {
+    const char* name;
+    int arity;
+    const char* usage;
 };
 
-// Global variables
-vector<Championship> championships;
-Championship* currentChampionship = nullptr;
+const BatchCommand BATCH_COMMANDS[] = {
+    {"load", 1, "load <file>                 Load championships from a text data file"},
+    {"save", 1, "save <file>                 Save championships to a text data file"},
+    {"load-snapshot", 1, "load-snapshot <file>        Load championships from a binary snapshot"},
+    {"save-snapshot", 1, "save-snapshot <file>        Save championships to a binary snapshot"},
+    {"load-archive", 1, "load-archive <file>         Load championships from a compact archive"},
+    {"save-archive", 1, "save-archive <file>         Save championships to a compact archive"},
+    {"create", 1, "create <name>               Create a championship and select it"},
+    {"select", 1, "select <name|number>        Select a championship"},
+    {"promote", 2, "promote <team> <value>      Add a team to the selected championship"},
+    {"relegate", 1, "relegate <team>             Remove a team from the selected championship"},
+    {"seed", 1, "seed <n>                    Set the random seed of the selected championship"},
+    {"tie-breaks", 1, "tie-breaks <rules>          Set tie-breaks after points, e.g. h2h-points,h2h-gd,gd,gf"},
+    {"generate-fixtures", 0, "generate-fixtures           Generate the round-robin fixtures"},
+    {"play-stage", 1, "play-stage <k>              Play stage k"},
+    {"play-stages", 2, "play-stages <from> <to>     Play stages from..to (inclusive)"},
+    {"play-season", 0, "play-season                 Play all remaining stages"},
+    {"fork", 1, "fork <name>                 Fork the selected championship and select the fork"},
+    {"undo-stages", 1, "undo-stages <n>             Undo the last n stage plays"},
+    {"redo-stages", 1, "redo-stages <n>             Redo n undone stage plays"},
+    {"restore-stage", 1, "restore-stage <k>           Restore the state after stage k (0: before stage 1)"},
+    {"play-matchday", 1, "play-matchday <k>           Play stage k in every championship and print a summary"},
+    {"reset", 0, "reset                       Reset championship statistics"},
+    {"standings", 0, "standings                   Print the standings table"},
+    {"position", 1, "position <team>             Print a team's position"},
+    {"position-at", 2, "position-at <team> <k>      Print a team's position after stage k"},
+    {"history", 1, "history <team>              Print a team's position and points after every stage"},
+    {"form", 1, "form <n>                    Print the form table over the last n stages"},
+    {"find", 1, "find <text>                 List teams matching a name or the start of a word"},
+    {"report", 0, "report                      Print the comparison report"},
+    {"compare", 2, "compare <metric> <metric>   Compare two rankings (points, value, gd, gf, points-per-value)"},
+    {"export", 1, "export <file>               Export standings (.json: JSON, .txt: table, otherwise CSV)"},
+    {"render", 1, "render <table|csv|json>     Print the standings in a format"},
+    {"simulate", 1, "simulate <seasons>          Run a Monte Carlo simulation and print the report"},
+    {"outlook", 0, "outlook                     Print which teams have clinched or lost the title and safety"},
+    {"benchmark", 1, "benchmark <max-teams>       Benchmark core operations on synthetic leagues"},
+    {"serve", 1, "serve <socket>              Answer queries on a Unix socket; runs until interrupted"},
+};
 
-// Save all championships to file
-void saveData(const string& filename) {
-    ofstream file(filename);
-    if (!file) {
-        cerr << "Error opening file for writing!\n";
-        return;
-    }
-    
-    file << championships.size() << '\n';
-    for (Championship& champ : championships) {
-        champ.saveToFile(file);
+const BatchCommand* findBatchCommand(const string& name) {
+    for (const BatchCommand& command : BATCH_COMMANDS) {
+        if (name == command.name) return &command;
     }
-    
-    cout << "Data saved successfully to " << filename << endl;
+    return nullptr;
 }
 
-// Load all championships from file
-void loadData(const string& filename) {
-    ifstream file(filename);
-    if (!file) {
-        cerr << "Error opening file for reading!\n";
-        return;
-    }
-    
-    championships.clear();
-    int count;
-    file >> count;
-    file.ignore();
-    
-    for (int i = 0; i < count; i++) {
-        Championship champ;
-        champ.loadFromFile(file);
-        championships.push_back(champ);
+void printUsage(const char* program) {
+    cout << "Usage: " << program << " [--seed <n>] [-f <script>] [command args...]...\n"
+         << "Without commands the interactive menu is started.\n\n"
+         << "Commands (also one per line in a script file, '#' starts a comment):\n";
+    for (const BatchCommand& command : BATCH_COMMANDS) {
+        cout << "  " << command.usage << '\n';
     }
-    
-    currentChampionship = nullptr;
-    cout << "Data loaded successfully from " << filename << endl;
 }
 
-// Main menu functions
-void createNewChampionship() {
-    string name;
-    cout << "Enter championship name: ";
-    getline(cin, name);
-    
-    championships.emplace_back(name);
-    currentChampionship = &championships.back();
-    cout << "Championship created successfully!\n";
+// Query commands write their result to stdout; everything else runs silently
+bool isBatchQuery(const string& cmd) {
+    return cmd == "standings" || cmd == "position" || cmd == "position-at" || cmd == "history" ||
+           cmd == "form" || cmd == "report" || cmd == "simulate" ||
+           cmd == "benchmark" || cmd == "play-matchday" || cmd == "outlook" || cmd == "find" ||
+           cmd == "compare" || cmd == "render";
 }
 
-void selectChampionship() {
-    if (championships.empty()) {
-        cout << "No championships available!\n";
-        return;
+// Run one batch command; returns false (after reporting to stderr) on failure
+bool executeBatchCommand(const vector<string>& args) {
+    const string& cmd = args[0];
+    const BatchCommand* command = findBatchCommand(cmd);
+    if (!command) {
+        cerr << "Unknown command: " << cmd << endl;
+        return false;
     }
-    
-    cout << "\nAvailable Championships:\n";
-    for (size_t i = 0; i < championships.size(); i++) {
-        cout << i + 1 << ". " << championships[i].getName() 
-             << " (" << championships[i].getTeamCount() << " teams)\n";
+    if (static_cast<int>(args.size()) - 1 != command->arity) {
+        cerr << "Usage: " << command->usage << endl;
+        return false;
     }
     
-    int choice;
-    cout << "Select championship (0 to cancel): ";
-    cin >> choice;
-    cin.ignore();
-    
-    if (choice == 0) return;
+    NullBuffer nullBuffer;
+    streambuf* console = cout.rdbuf();
+    if (!isBatchQuery(cmd)) cout.rdbuf(&nullBuffer);
+    struct RestoreCout {
+        streambuf* buffer;
+        ~RestoreCout() { cout.rdbuf(buffer); }
+    } restore = {console};
     
-    if (choice > 0 && choice <= static_cast<int>(championships.size())) {
-        currentChampionship = &championships[choice - 1];
-        cout << "Selected: " << currentChampionship->getName() << endl;
-    } else {
-        cout << "Invalid selection!\n";
+    if (cmd == "load") {
+        if (!loadData(args[1])) return false;
+        if (!championships.empty()) currentChampionship = &championships[0];
+        return true;
     }
-}
-
-void relegateTeam() {
-    if (!currentChampionship) {
-        cout << "No championship selected!\n";
-        return;
+    if (cmd == "save") return saveData(args[1]);
+    if (cmd == "load-snapshot") {
+        if (!loadSnapshot(args[1])) return false;
+        if (!championships.empty()) currentChampionship = &championships[0];
+        return true;
     }
-    
-    string name;
-    cout << "Enter team to relegate: ";
-    getline(cin, name);
-    currentChampionship->relegateTeam(name);
-}
-
-void promoteTeam() {
-    if (!currentChampionship) {
-        cout << "No championship selected!\n";
-        return;
+    if (cmd == "save-snapshot") return saveSnapshot(args[1]);
+    if (cmd == "load-archive") {
+        if (!loadArchive(args[1])) return false;
+        if (!championships.empty()) currentChampionship = &championships[0];
+        return true;
     }
-    
-    string name;
-    double value;
-    cout << "Enter team name: ";
-    getline(cin, name);
-    cout << "Enter team value (in millions): ";
-    
-    // Input validation
-    while (!(cin >> value) || value < 0) {
-        cin.clear();
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        cout << "Invalid value! Please enter a positive number: ";
+    if (cmd == "save-archive") return saveArchive(args[1]);
+    if (cmd == "serve") return queryServer.start(args[1]);
+    if (cmd == "benchmark") {
+        int maxTeams;
+        if (!parseBatchInt(args[1], maxTeams) || maxTeams < BENCH_LEAGUE_SIZES[0]) {
+            cerr << "Invalid league size: " << args[1] << endl;
+            return false;
+        }
+        runBenchmarks(maxTeams, cout);
+        return true;
     }
-    cin.ignore();
-    
-    currentChampionship->promoteTeam(Team(name, value));
-}
-
-void findTeam() {
-    if (!currentChampionship) {
-        cout << "No championship selected!\n";
-        return;
+    if (cmd == "create") {
+        championships.emplace_back(args[1]);
+        currentChampionship = &championships.back();
+        if (hasSeedOverride) {
+            currentChampionship->setSeed(seedOverride);
+        }
+        journal.recordCreate(args[1]);
+        journal.recordSeed(championshipIndex(currentChampionship), currentChampionship->getSeed());
+        return true;
+    }
+    if (cmd == "select") {
+        int number;
+        for (size_t i = 0; i < championships.size(); i++) {
+            if (championships.nameAt(i) == args[1] ||
+                (parseBatchInt(args[1], number) && number == static_cast<int>(i) + 1)) {
+                currentChampionship = &championships[i];
+                return true;
+            }
+        }
+        cerr << "Championship not found: " << args[1] << endl;
+        return false;
     }
     
-    string name;
-    cout << "Enter team name: ";
-    getline(cin, name);
-    
-    Team* team = currentChampionship->findTeam(name);
-    if (team) {
-        cout << "\nTeam found:\n";
-        team->display();
-    } else {
-        cout << "Team not found!\n";
+    // Everything below works on the selected championship
+    if (cmd == "play-matchday") {
+        int stage;
+        if (!parseBatchInt(args[1], stage) || championships.empty()) {
+            cerr << "Invalid stage or no championships loaded: " << args[1] << endl;
+            return false;
+        }
+        displayMatchdaySummary(stage - 1, runMatchday(stage - 1));
+        return true;
     }
-}
-
-void generateFixtures() {
+    
     if (!currentChampionship) {
-        cout << "No championship selected!\n";
-        return;
+        cerr << cmd << ": no championship selected\n";
+        return false;
     }
+    Championship& champ = *currentChampionship;
+    int index = championshipIndex(currentChampionship);
+    int first, last;
     
-    if (currentChampionship->getTeamCount() < 2) {
-        cout << "Not enough teams to generate fixtures!\n";
-        return;
+    if (cmd == "promote") {
+        double value;
+        try {
+            value = stod(args[2]);
+        } catch (const exception&) {
+            value = -1;
+        }
+        if (value < 0) {
+            cerr << "Invalid team value: " << args[2] << endl;
+            return false;
+        }
+        Team team(args[1], value);
+        if (!champ.promoteTeam(team)) {
+            cerr << args[1] << " is already in the championship\n";
+            return false;
+        }
+        journal.recordPromote(index, team);
+    } else if (cmd == "relegate") {
+        if (champ.getTeamPosition(args[1]) == -1) {
+            cerr << "Team not found: " << args[1] << endl;
+            return false;
+        }
+        champ.relegateTeam(args[1]);
+        journal.recordRelegate(index, args[1]);
+    } else if (cmd == "seed") {
+        uint64_t seed;
+        if (!parseBatchSeed(args[1], seed)) {
+            cerr << "Invalid seed: " << args[1] << endl;
+            return false;
+        }
+        champ.setSeed(seed);
+        journal.recordSeed(index, champ.getSeed());
+    } else if (cmd == "tie-breaks") {
+        TieBreakRules rules;
+        if (!rules.parse(args[1])) {
+            cerr << "Invalid tie-break rules: " << args[1] << endl;
+            return false;
+        }
+        if (!champ.setTieBreaks(rules)) {
+            cerr << "Head-to-head tie-breaks support at most " << HEAD_TO_HEAD_MAX_TEAMS << " teams\n";
+            return false;
+        }
+        journal.recordTieBreaks(index, rules);
+    } else if (cmd == "generate-fixtures") {
+        if (champ.getTeamCount() < 2) {
+            cerr << "Not enough teams to generate fixtures\n";
+            return false;
+        }
+        champ.generateFixtures();
+        journal.recordGenerate(index);
+    } else if (cmd == "play-stage" || cmd == "play-stages" || cmd == "play-season") {
+        if (cmd == "play-season") {
+            first = champ.getStagesCompleted() + 1;
+            last = champ.getTotalStages();
+        } else if (!parseBatchInt(args[1], first) ||
+                   !parseBatchInt(args[cmd == "play-stage" ? 1 : 2], last)) {
+            cerr << "Invalid stage number\n";
+            return false;
+        }
+        if (first < 1 || last > champ.getTotalStages() || (first > last && cmd != "play-season")) {
+            cerr << "Stage out of range (1-" << champ.getTotalStages() << ")\n";
+            return false;
+        }
+        for (int stage = first; stage <= last; stage++) {
+            champ.playStage(stage - 1, false);
+            journal.recordStage(index, champ, stage - 1);
+            queryServer.publish(index);
+        }
+    } else if (cmd == "fork") {
+        championships.push_back(champ.fork(args[1]));
+        currentChampionship = &championships.back();
+        journal.recordFork(index, args[1]);
+    } else if (cmd == "undo-stages" || cmd == "redo-stages") {
+        int count;
+        int available = cmd == "undo-stages" ? champ.getUndoCount() : champ.getRedoCount();
+        if (!parseBatchInt(args[1], count) || count < 1 || count > available) {
+            cerr << "Cannot " << cmd.substr(0, 4) << ' ' << args[1] << " stage(s); "
+                 << available << " available\n";
+            return false;
+        }
+        stepStageHistory(champ, cmd == "undo-stages" ? -count : count);
+    } else if (cmd == "restore-stage") {
+        int stage, steps;
+        if (!parseBatchInt(args[1], stage) || !champ.stepsToStage(stage, steps)) {
+            cerr << "Stage " << args[1] << " is not in the undo history\n";
+            return false;
+        }
+        stepStageHistory(champ, steps);
+    } else if (cmd == "reset") {
+        champ.resetChampionship();
+        journal.recordReset(index);
+    } else if (cmd == "standings") {
+        champ.displayStandings();
+    } else if (cmd == "position") {
+        int position = champ.getTeamPosition(args[1]);
+        if (position == -1) {
+            cerr << "Team not found: " << args[1] << endl;
+            return false;
+        }
+        cout << args[1] << " is in position #" << position << endl;
+    } else if (cmd == "position-at") {
+        int stage;
+        int position = parseBatchInt(args[2], stage) ? champ.getTeamPositionAt(args[1], stage) : -1;
+        if (position == -1) {
+            cerr << "No position for " << args[1] << " after stage " << args[2] << endl;
+            return false;
+        }
+        cout << args[1] << " was in position #" << position << " after stage " << stage << endl;
+    } else if (cmd == "history") {
+        if (!champ.displayTeamHistory(args[1])) {
+            cerr << "Team not found: " << args[1] << endl;
+            return false;
+        }
+    } else if (cmd == "form") {
+        int window;
+        if (!parseBatchInt(args[1], window) || window <= 0) {
+            cerr << "Invalid number of stages: " << args[1] << endl;
+            return false;
+        }
+        champ.displayFormTable(window);
+    } else if (cmd == "report") {
+        champ.generateComparisonReport();
+    } else if (cmd == "compare") {
+        Metric first, second;
+        if (!parseMetric(args[1], first) || !parseMetric(args[2], second)) {
+            cerr << "Invalid metrics: " << args[1] << " " << args[2] << endl;
+            return false;
+        }
+        champ.generateComparisonReport(first, second);
+    } else if (cmd == "find") {
+        vector<Team> matches = champ.searchTeams(args[1]);
+        if (matches.empty()) {
+            cerr << "No team matches: " << args[1] << endl;
+            return false;
+        }
+        for (const Team& match : matches) {
+            cout << match.name << " (#" << champ.getTeamPosition(match.name) << ", "
+                 << match.getPoints() << " pts)\n";
+        }
+    } else if (cmd == "outlook") {
+        SeasonOutlook outlook = champ.analyzeOutlook();
+        champ.displayOutlook(outlook);
+        champ.displayOutlookSummary(outlook);
+    } else if (cmd == "export") {
+        ofstream probe(args[1]);
+        if (!probe) {
+            cerr << "Error opening file for writing: " << args[1] << endl;
+            return false;
+        }
+        probe.close();
+        champ.exportStandings(args[1], standingsFormatFor(args[1]));
+    } else if (cmd == "render") {
+        StandingsFormat format;
+        if (!parseStandingsFormat(args[1], format)) {
+            cerr << "Invalid format: " << args[1] << endl;
+            return false;
+        }
+        cout << champ.renderStandings(format) << flush;
+    } else if (cmd == "simulate") {
+        int seasons;
+        if (!parseBatchInt(args[1], seasons) || seasons <= 0 || champ.getTeamCount() < 2) {
+            cerr << "Invalid simulation request\n";
+            return false;
+        }
+        if (champ.getTeamCount() > SIMULATION_MAX_TEAMS) {
+            cerr << "Too many teams to simulate (at most " << SIMULATION_MAX_TEAMS << ")\n";
+            return false;
+        }
+        champ.displaySimulationReport(champ.simulateSeasons(seasons));
     }
-    
-    currentChampionship->generateFixtures();
-    cout << "Fixtures generated successfully!\n";
+    return true;
 }
 
-void playStage() {
-    if (!currentChampionship) {
-        cout << "No championship selected!\n";
-        return;
+// Run one batch command, then publish what it changed to the query server
+bool runBatchCommand(const vector<string>& args) {
+    bool succeeded = executeBatchCommand(args);
+    if (!isBatchQuery(args[0]) || args[0] == "play-matchday") {
+        queryServer.publish();
     }
-    
-    int stage;
-    cout << "Enter stage number to play: ";
-    cin >> stage;
-    cin.ignore();
-    
-    currentChampionship->playStage(stage - 1);
+    return succeeded;
 }
 
-void resetChampionship() {
-    if (!currentChampionship) {
-        cout << "No championship selected!\n";
-        return;
+// Run a script file, one command per line; stops at the first failure
+bool runBatchScript(const string& filename) {
+    ifstream script(filename);
+    if (!script) {
+        cerr << "Error opening script file: " << filename << endl;
+        return false;
     }
     
-    char confirm;
-    cout << "Are you sure you want to reset all statistics? (y/n): ";
-    cin >> confirm;
-    cin.ignore();
-    
-    if (tolower(confirm) == 'y') {
-        currentChampionship->resetChampionship();
+    string line;
+    int lineNumber = 0;
+    while (getline(script, line)) {
+        lineNumber++;
+        vector<string> words = splitScriptLine(line);
+        if (words.empty()) continue;
+        if (!runBatchCommand(words)) {
+            cerr << filename << ":" << lineNumber << ": command failed\n";
+            return false;
+        }
     }
+    return true;
 }
 
 // Main application menu
-int main() {
+// Whether a menu choice may change the championships or the selection (the
+// others only display them or write files), so the query server needs a new
+// snapshot afterwards
+bool menuChoiceChangesData(int choice) {
+    switch (choice) {
+        case 1: case 2: case 3: case 4: case 6: case 7: case 14: case 15: case 17:
+        case 19: case 20: case 21: case 22: case 23: case 24: case 26: case 30:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int main(int argc, char* argv[]) {
     const string FILENAME = "championship_data.txt";
+    const string SNAPSHOT_FILENAME = "championship_data.bin";
+    const string ARCHIVE_FILENAME = "championship_archive.fca";
     int choice;
     
+    // Command line options and batch commands
+    vector<vector<string>> batchCommands;
+    vector<string> scripts;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            if (!parseBatchSeed(argv[++i], seedOverride)) {
+                cerr << "Invalid seed: " << argv[i] << endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            hasSeedOverride = true;
+        } else if ((arg == "-f" || arg == "--script") && i + 1 < argc) {
+            scripts.push_back(argv[++i]);
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (const BatchCommand* command = findBatchCommand(arg)) {
+            if (i + command->arity >= argc) {
+                cerr << "Usage: " << command->usage << endl;
+                return 1;
+            }
+            vector<string> words(argv + i, argv + i + command->arity + 1);
+            batchCommands.push_back(words);
+            i += command->arity;
+        } else {
+            cerr << "Unknown option or command: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    // Batch mode: scripts first, then command line commands, then exit
+    if (!scripts.empty() || !batchCommands.empty()) {
+        for (const string& script : scripts) {
+            if (!runBatchScript(script)) return 1;
+        }
+        for (const vector<string>& words : batchCommands) {
+            if (!runBatchCommand(words)) return 1;
+        }
+        if (queryServer.running()) serveUntilInterrupted();
+        return 0;
+    }
+    
     do {
         cout << "\n===== Romanian Football Championship Manager =====\n";
         cout << "Current Championship: ";
@@ -758,10 +6937,26 @@ int main() {
         cout << "9. Show Team Position\n";
         cout << "10. Show Value-Based Standings\n";
         cout << "11. Generate Comparison Report\n";
-        cout << "12. Export Standings to CSV\n";
+        cout << "12. Export Standings (CSV, JSON or table)\n";
         cout << "13. Save Data\n";
         cout << "14. Load Data\n";
         cout << "15. Reset Championship Statistics\n";
+        cout << "16. Simulate Seasons (Monte Carlo)\n";
+        cout << "17. Set Random Seed\n";
+        cout << "18. Save Binary Snapshot\n";
+        cout << "19. Load Binary Snapshot\n";
+        cout << "20. Play Stage in All Championships\n";
+        cout << "21. Undo Stages\n";
+        cout << "22. Redo Stages\n";
+        cout << "23. Restore to Stage\n";
+        cout << "24. Fork Championship (What-If Scenario)\n";
+        cout << "25. Show Clinched/Eliminated Teams\n";
+        cout << "26. Set Tie-Break Rules\n";
+        cout << "27. Show Team History\n";
+        cout << "28. Show Form Table\n";
+        cout << "29. Save Archive\n";
+        cout << "30. Load Archive\n";
+        cout << "31. Start Query Server\n";
         cout << "0. Exit\n";
         cout << "Enter choice: ";
         
@@ -804,16 +6999,13 @@ int main() {
                 if (currentChampionship) currentChampionship->displayValueStandings(); 
                 else cout << "No championship selected!\n";
                 break;
-            case 11: 
-                if (currentChampionship) currentChampionship->generateComparisonReport(); 
-                else cout << "No championship selected!\n";
-                break;
+            case 11: generateComparisonReport(); break;
             case 12:
                 if (currentChampionship) {
                     string filename;
-                    cout << "Enter filename (e.g., standings.csv): ";
+                    cout << "Enter filename (e.g., standings.csv, .json or .txt): ";
                     getline(cin, filename);
-                    currentChampionship->exportStandingsToCSV(filename);
+                    currentChampionship->exportStandings(filename, standingsFormatFor(filename));
                 } else {
                     cout << "No championship selected!\n";
                 }
@@ -824,9 +7016,34 @@ int main() {
                 if (!championships.empty()) currentChampionship = &championships[0];
                 break;
             case 15: resetChampionship(); break;
+            case 16: simulateSeasons(); break;
+            case 17: setRandomSeed(); break;
+            case 18: saveSnapshot(SNAPSHOT_FILENAME); break;
+            case 19: 
+                loadSnapshot(SNAPSHOT_FILENAME); 
+                if (!championships.empty()) currentChampionship = &championships[0];
+                break;
+            case 20: playMatchday(); break;
+            case 21: undoRedoStages(true); break;
+            case 22: undoRedoStages(false); break;
+            case 23: restoreToStage(); break;
+            case 24: forkChampionship(); break;
+            case 25: showSeasonOutlook(); break;
+            case 26: setTieBreakRules(); break;
+            case 27: showTeamHistory(); break;
+            case 28: showFormTable(); break;
+            case 29: saveArchive(ARCHIVE_FILENAME); break;
+            case 30: 
+                loadArchive(ARCHIVE_FILENAME); 
+                if (!championships.empty()) currentChampionship = &championships[0];
+                break;
+            case 31: startQueryServer(); break;
             case 0: cout << "Exiting...\n"; break;
             default: cout << "Invalid choice! Please try again.\n";
         }
+        if (menuChoiceChangesData(choice)) {
+            queryServer.publish();
+        }
     } while (choice != 0);
     
     return 0;
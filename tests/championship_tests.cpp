@@ -0,0 +1,1908 @@
+// Behaviour tests for the football championship manager.
+// The program is a single translation unit, so it is included here with its
+// main() renamed; every test drives the same globals (championships, the
+// journal, the query server) the menu and batch mode use.
+//
+// Build and run from the repository root: make test
+
+#define main football_manager_main
+#include "../Football_Championship_v1_1_0.cpp"
+#undef main
+
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+#include <unistd.h>
+
+// ===== Test runner =====
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+vector<TestCase>& testCases() {
+    static vector<TestCase> cases;
+    return cases;
+}
+
+struct TestRegistration {
+    TestRegistration(const char* name, void (*run)()) { testCases().push_back({name, run}); }
+};
+
+#define TEST(name) \
+    void name(); \
+    TestRegistration name##Registration(#name, name); \
+    void name()
+
+int checkFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            checkFailures++; \
+            printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        if (!((actual) == (expected))) { \
+            checkFailures++; \
+            printf("  %s:%d: CHECK_EQ(%s, %s) failed\n", __FILE__, __LINE__, #actual, #expected); \
+        } \
+    } while (0)
+
+// Discards everything written to it
+class DiscardBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+// Silences cout and cerr while in scope (the program reports progress and
+// expected errors there)
+class QuietOutput {
+private:
+    DiscardBuffer sink;
+    streambuf* out;
+    streambuf* err;
+
+public:
+    QuietOutput() : out(cout.rdbuf(&sink)), err(cerr.rdbuf(&sink)) {}
+    ~QuietOutput() {
+        cout.rdbuf(out);
+        cerr.rdbuf(err);
+    }
+};
+
+// Start a test from an empty program state
+void resetProgramState() {
+    queryServer.stop();
+    journal.detach();
+    championships.clear();
+    currentChampionship = nullptr;
+    hasSeedOverride = false;
+}
+
+string readFile(const string& path) {
+    ifstream file(path, ios::binary);
+    return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+void writeFile(const string& path, const string& contents) {
+    ofstream file(path, ios::binary | ios::trunc);
+    file << contents;
+}
+
+// Everything printed to cout by action
+template <typename Action>
+string captureOutput(Action action) {
+    ostringstream captured;
+    streambuf* out = cout.rdbuf(captured.rdbuf());
+    action();
+    cout.rdbuf(out);
+    return captured.str();
+}
+
+// ===== Test leagues =====
+
+// League of teamCount teams with deterministic names and values
+Championship makeLeague(const string& name, int teamCount, uint64_t seed) {
+    Championship champ(name);
+    champ.setSeed(seed);
+    for (int i = 0; i < teamCount; i++) {
+        champ.addTeam(Team("Team " + to_string(i + 1), 10.0 + (i * 37) % 90));
+    }
+    return champ;
+}
+
+// Everything observable about a championship's state
+string describe(const Championship& champ, bool withPlays = true) {
+    ostringstream out;
+    out << champ.getName() << '|' << champ.getSeed() << '|' << champ.getStagesCompleted() << '/'
+        << champ.getTotalStages() << '|' << champ.getTieBreaks().toString() << '\n';
+    out << champ.renderStandings(StandingsFormat::CSV);
+    for (int stage = 0; stage < champ.getTotalStages(); stage++) {
+        out << stage << ':';
+        if (withPlays) out << champ.getStagePlays(stage) << ':';
+        for (const MatchResult& result : champ.getStageResults(stage)) {
+            out << ' ' << int(result.homeGoals) << '-' << int(result.awayGoals) << '/' << int(result.played);
+        }
+        out << '\n';
+    }
+    return out.str();
+}
+
+string describeAll(bool withPlays = true) {
+    string all;
+    for (size_t i = 0; i < championships.size(); i++) all += describe(championships[i], withPlays);
+    return all;
+}
+
+// Two championships with some stages played and a relegated team
+void buildSampleChampionships() {
+    QuietOutput quiet;
+    resetProgramState();
+    Championship& first = championships.push_back(makeLeague("Liga 1", 8, 11));
+    first.generateFixtures();
+    for (int stage = 0; stage < 5; stage++) first.playStage(stage);
+    first.relegateTeam("Team 8");
+
+    Championship& second = championships.push_back(makeLeague("Liga 2", 7, 22));
+    TieBreakRules rules;
+    rules.parse("h2h-points,h2h-gd,gd");
+    second.setTieBreaks(rules);
+    second.generateFixtures();
+    for (int stage = 0; stage < 3; stage++) second.playStage(stage);
+    currentChampionship = &championships[0];
+}
+
+// ===== Match RNG =====
+
+TEST(rngStreamsAreDeterministicAndIndependent) {
+    CHECK_EQ(MatchRng::streamKey(1, 2, 3), MatchRng::streamKey(1, 2, 3));
+    CHECK(MatchRng::streamKey(1, 2, 3) != MatchRng::streamKey(2, 2, 3));
+    CHECK(MatchRng::streamKey(1, 2, 3) != MatchRng::streamKey(1, 3, 3));
+    CHECK(MatchRng::streamKey(1, 2, 3) != MatchRng::streamKey(1, 2, 4));
+    CHECK(MatchRng::streamKey(1, 2, 3, 1) != MatchRng::streamKey(1, 2, 3, 2));
+    CHECK_EQ(MatchRng::streamKey(1, 2, 3, 0), MatchRng::streamKey(1, 2, 3));
+
+    uint64_t key = MatchRng::streamKey(42, 0, 7);
+    double sum = 0.0;
+    for (int match = 0; match < 10000; match++) {
+        double u = MatchRng::uniform(key, match, match & 1);
+        CHECK(u >= 0.0 && u < 1.0);
+        sum += u;
+    }
+    CHECK(fabs(sum / 10000 - 0.5) < 0.02);
+}
+
+// One capped inverse-CDF Poisson sample, a match at a time
+int cappedPoissonReference(double lambda, double u) {
+    double p = exp(-lambda);
+    double cdf = p;
+    int k = 0;
+    while (k < MAX_GOALS && u >= cdf) {
+        k++;
+        p *= lambda / k;
+        cdf += p;
+    }
+    return k;
+}
+
+TEST(stageKernelSamplesLikeOneMatchAtATime) {
+    mt19937_64 rng(13);
+    StageBatch batch;
+    for (int m = 0; m < 37; m++) {
+        batch.add(m, m + 1, m, 1.0 + rng() % 200, 1.0 + rng() % 200);
+    }
+    StageSample sample;
+    for (uint64_t stage = 0; stage < 20; stage++) {
+        uint64_t key = MatchRng::streamKey(9, 0, stage);
+        sample.run(batch, key);
+        for (size_t i = 0; i < batch.size(); i++) {
+            CHECK_EQ(sample.homeGoals[i], cappedPoissonReference(batch.homeRate[i], MatchRng::uniform(key, i, 0)));
+            CHECK_EQ(sample.awayGoals[i], cappedPoissonReference(batch.awayRate[i], MatchRng::uniform(key, i, 1)));
+        }
+    }
+}
+
+TEST(seededChampionshipsPlayIdenticalSeasons) {
+    QuietOutput quiet;
+    Championship a = makeLeague("A", 10, 99), b = makeLeague("A", 10, 99), c = makeLeague("A", 10, 100);
+    for (Championship* champ : {&a, &b, &c}) {
+        champ->generateFixtures();
+        for (int stage = 0; stage < 18; stage++) champ->playStage(stage);
+    }
+    CHECK_EQ(describe(a), describe(b));
+    c.setSeed(99);
+    CHECK(describe(a) != describe(c));
+}
+
+TEST(replayedStagesDrawNewScoresDeterministically) {
+    QuietOutput quiet;
+    Championship a = makeLeague("A", 16, 5), b = makeLeague("A", 16, 5);
+    vector<vector<MatchResult>> draws;
+    for (Championship* champ : {&a, &b}) {
+        champ->generateFixtures();
+        for (int play = 0; play < 4; play++) {
+            champ->playStage(0, false);
+            if (champ == &a) draws.push_back(champ->getStageResults(0));
+        }
+    }
+    CHECK_EQ(a.getStagePlays(0), 4u);
+    CHECK(draws[0] != draws[1] || draws[1] != draws[2] || draws[2] != draws[3]);
+    CHECK_EQ(describe(a), describe(b));
+
+    a.setSeed(5);
+    CHECK_EQ(a.getStagePlays(0), 0u);
+}
+
+TEST(seedIsSavedWithTheChampionship) {
+    QuietOutput quiet;
+    championships.clear();
+    championships.push_back(makeLeague("Seeded", 4, 1234567890123ULL));
+    CHECK(saveData("seeded.txt"));
+    championships.clear();
+    CHECK(loadData("seeded.txt"));
+    CHECK_EQ(championships.size(), 1u);
+    CHECK_EQ(championships[0].getSeed(), 1234567890123ULL);
+
+    // Files from before the seed was stored still load
+    writeFile("unseeded.txt", "1\nOld\n2 0 0\nA,10,0,0,0,0,0\nB,20,0,0,0,0,0\n0\n");
+    CHECK(loadData("unseeded.txt"));
+    CHECK_EQ(championships.size(), 1u);
+    CHECK_EQ(championships[0].getTeamCount(), 2);
+    championships.clear();
+}
+
+// ===== Fixtures =====
+
+// The circle method with every round materialized: pair i with n-1-i, then
+// rotate every position but the first
+vector<vector<pair<int, int>>> materializedCircle(vector<int> roster) {
+    if (roster.size() % 2 != 0) roster.push_back(FixtureSchedule::BYE);
+    int n = roster.size();
+    vector<vector<pair<int, int>>> rounds;
+    for (int round = 0; round < (n - 1) * 2; round++) {
+        vector<pair<int, int>> matches;
+        for (int i = 0; i < n / 2; i++) {
+            int home = roster[i], away = roster[n - 1 - i];
+            if (home == FixtureSchedule::BYE || away == FixtureSchedule::BYE) continue;
+            matches.push_back(round % 2 == 0 ? make_pair(home, away) : make_pair(away, home));
+        }
+        rounds.push_back(matches);
+        rotate(roster.begin() + 1, roster.begin() + n - 1, roster.end());
+    }
+    return rounds;
+}
+
+TEST(circleMethodMeetsEveryOpponentHomeAndAway) {
+    for (int n = 2; n <= 11; n++) {
+        vector<int> ids(n);
+        iota(ids.begin(), ids.end(), 100);
+        FixtureSchedule schedule;
+        schedule.generate(ids);
+        CHECK_EQ(schedule.stageCount(), 2 * (n % 2 == 0 ? n - 1 : n));
+
+        set<pair<int, int>> seen;
+        for (int stage = 0; stage < schedule.stageCount(); stage++) {
+            set<int> playing;
+            for (int slot = 0; slot < schedule.matchCount(stage); slot++) {
+                pair<int, int> teams = schedule.teamsAt(stage, slot);
+                CHECK(teams.first != teams.second);
+                CHECK(playing.insert(teams.first).second);
+                CHECK(playing.insert(teams.second).second);
+                CHECK(seen.insert(teams).second);
+            }
+            CHECK_EQ(static_cast<int>(playing.size()), n - n % 2);
+        }
+        CHECK_EQ(static_cast<int>(seen.size()), n * (n - 1));
+    }
+}
+
+TEST(computedFixturesKeepTheMaterializedSlotOrder) {
+    for (int n : {2, 3, 8, 13, 20}) {
+        vector<int> ids(n);
+        iota(ids.begin(), ids.end(), 0);
+        shuffle(ids.begin(), ids.end(), mt19937(n));
+        FixtureSchedule schedule;
+        schedule.generate(ids);
+        vector<vector<pair<int, int>>> expected = materializedCircle(ids);
+        CHECK_EQ(schedule.stageCount(), static_cast<int>(expected.size()));
+        for (int stage = 0; stage < schedule.stageCount(); stage++) {
+            CHECK_EQ(schedule.matchCount(stage), static_cast<int>(expected[stage].size()));
+            for (int slot = 0; slot < schedule.matchCount(stage); slot++) {
+                CHECK(schedule.teamsAt(stage, slot) == expected[stage][slot]);
+            }
+        }
+    }
+
+    // A list that does not follow the formula is kept as explicit pairs
+    vector<vector<Match>> custom = {{Match(0, 1), Match(2, 3)}, {Match(3, 0)}};
+    custom[1][0].homeGoals = 2;
+    custom[1][0].played = true;
+    FixtureSchedule explicitSchedule;
+    explicitSchedule.assign(custom, {0, 1, 2, 3});
+    CHECK(!explicitSchedule.isGenerated());
+    CHECK_EQ(explicitSchedule.matchCount(0), 2);
+    CHECK_EQ(explicitSchedule.matchCount(1), 1);
+    CHECK(explicitSchedule.teamsAt(1, 0) == make_pair(3, 0));
+    CHECK_EQ(explicitSchedule.at(1, 0).homeGoals, 2);
+    CHECK(explicitSchedule.at(1, 0).played);
+    CHECK(!explicitSchedule.at(0, 1).played);
+}
+
+// ===== Tie-breaks =====
+
+TEST(headToHeadBreaksTiesOnPoints) {
+    // Teams 0, 1 and 2 are level on points; 2 beat both others, 1 beat 0
+    HeadToHeadMatrix matrix;
+    matrix.reset(3);
+    matrix.addResult(2, 0, 1, 0, +1);
+    matrix.addResult(2, 1, 2, 1, +1);
+    matrix.addResult(1, 0, 3, 0, +1);
+    int points[] = {10, 10, 10}, goalDifference[] = {9, 5, 1}, goalsFor[] = {20, 20, 20};
+    auto pointsOf = [&](int t) { return points[t]; };
+    auto goalDifferenceOf = [&](int t) { return goalDifference[t]; };
+    auto goalsForOf = [&](int t) { return goalsFor[t]; };
+    TieBreakScratch scratch;
+
+    TieBreakRules standard;
+    vector<int> order = {0, 1, 2};
+    standard.resolve(order, pointsOf, goalDifferenceOf, goalsForOf, matrix, scratch);
+    CHECK((order == vector<int>{0, 1, 2}));
+
+    TieBreakRules headToHead;
+    CHECK(headToHead.parse("h2h-points,gd"));
+    CHECK_EQ(headToHead.toString(), "h2h-points,gd");
+    order = {0, 1, 2};
+    headToHead.resolve(order, pointsOf, goalDifferenceOf, goalsForOf, matrix, scratch);
+    CHECK((order == vector<int>{2, 1, 0}));
+
+    TieBreakRules unpacked;
+    CHECK(unpacked.unpack(headToHead.pack()));
+    CHECK_EQ(unpacked.toString(), headToHead.toString());
+    CHECK(!unpacked.parse("h2h-points,bogus"));
+    CHECK(!unpacked.parse(""));
+}
+
+TEST(standingsFollowTheTieBreakRules) {
+    QuietOutput quiet;
+    Championship champ = makeLeague("Ties", 6, 8);
+    TieBreakRules rules;
+    rules.parse("h2h-points,h2h-goals,gd,gf");
+    champ.setTieBreaks(rules);
+    champ.generateFixtures();
+    for (int stage = 0; stage < 6; stage++) champ.playStage(stage, false);
+    CHECK_EQ(champ.getTieBreaks().toString(), "h2h-points,h2h-goals,gd,gf");
+
+    // Positions are ordered by points, and the saved rules rank the same way
+    stringstream saved;
+    champ.saveToFile(saved);
+    Championship loaded;
+    loaded.loadFromFile(saved, DATA_FORMAT_VERSION);
+    CHECK_EQ(loaded.getTieBreaks().toString(), champ.getTieBreaks().toString());
+    int previous = numeric_limits<int>::max();
+    for (int position = 0; position < 6; position++) {
+        Team team = champ.getTeamAtPosition(position);
+        CHECK(team.getPoints() <= previous);
+        previous = team.getPoints();
+        CHECK_EQ(loaded.getTeamAtPosition(position).name, team.name);
+    }
+
+    QuietOutput quietTooLarge;
+    Championship large = makeLeague("Large", HEAD_TO_HEAD_MAX_TEAMS + 1, 1);
+    CHECK(!large.setTieBreaks(rules));
+}
+
+// ===== Undo and redo =====
+
+TEST(undoAndRedoRestoreEarlierStandings) {
+    QuietOutput quiet;
+    Championship champ = makeLeague("Undo", 8, 4);
+    champ.generateFixtures();
+    vector<string> states = {describe(champ, false)};
+    for (int stage = 0; stage < 4; stage++) {
+        champ.playStage(stage, false);
+        states.push_back(describe(champ, false));
+    }
+    CHECK_EQ(champ.getUndoCount(), 4);
+    CHECK(champ.undoStage());
+    CHECK(champ.undoStage());
+    CHECK_EQ(describe(champ, false), states[2]);
+    CHECK_EQ(champ.getRedoCount(), 2);
+    CHECK(champ.redoStage());
+    CHECK_EQ(describe(champ, false), states[3]);
+    while (champ.undoStage()) {}
+    CHECK_EQ(describe(champ, false), states[0]);
+    while (champ.redoStage()) {}
+    CHECK_EQ(describe(champ, false), states[4]);
+
+    int steps = 0;
+    CHECK(champ.stepsToStage(1, steps));
+    CHECK_EQ(steps, -3);
+    CHECK(!champ.stepsToStage(7, steps));
+
+    // Playing after an undo drops the redo history
+    champ.undoStage();
+    champ.playStage(3, false);
+    CHECK_EQ(champ.getRedoCount(), 0);
+    CHECK(!champ.redoStage());
+}
+
+TEST(batchUndoAndRestoreAreJournaled) {
+    buildSampleChampionships();
+    QuietOutput quiet;
+    CHECK(saveData("history.txt"));
+    CHECK(runBatchCommand({"select", "Liga 2"}));
+    string afterThree = describe(championships[1], false);
+    CHECK(runBatchCommand({"play-stages", "4", "6"}));
+    CHECK(!runBatchCommand({"undo-stages", "7"}));
+    CHECK(runBatchCommand({"undo-stages", "2"}));
+    CHECK(runBatchCommand({"redo-stages", "1"}));
+    CHECK(!runBatchCommand({"restore-stage", "9"}));
+    CHECK(runBatchCommand({"restore-stage", "3"}));
+    CHECK_EQ(describe(championships[1], false), afterThree);
+    CHECK(runBatchCommand({"redo-stages", "2"}));
+    string expected = describeAll();
+    CHECK(saveData("history.txt"));
+
+    championships.clear();
+    CHECK(loadData("history.txt"));
+    CHECK_EQ(describeAll(), expected);
+}
+
+// ===== Season outlook =====
+
+// Whether team x can still finish level with or above every other team, by
+// trying every outcome of the remaining matches
+bool titlePossibleByEnumeration(int x, vector<int> points, const vector<pair<int, int>>& remaining, size_t next = 0) {
+    if (next == remaining.size()) {
+        for (size_t j = 0; j < points.size(); j++) {
+            if (points[j] > points[x]) return false;
+        }
+        return true;
+    }
+    int home = remaining[next].first, away = remaining[next].second;
+    const int outcomes[3][2] = {{3, 0}, {1, 1}, {0, 3}};
+    for (const auto& outcome : outcomes) {
+        points[home] += outcome[0];
+        points[away] += outcome[1];
+        if (titlePossibleByEnumeration(x, points, remaining, next + 1)) return true;
+        points[home] -= outcome[0];
+        points[away] -= outcome[1];
+    }
+    return false;
+}
+
+TEST(outlookAgreesWithExhaustiveSearch) {
+    QuietOutput quiet;
+    for (uint64_t seed = 1; seed <= 12; seed++) {
+        Championship champ = makeLeague("Outlook", 6, seed);
+        champ.generateFixtures();
+        FixtureSchedule schedule;
+        schedule.generate(champ.rosterIds());
+        int played = 6 + seed % 3;
+        for (int stage = 0; stage < played; stage++) champ.playStage(stage, false);
+
+        map<int, int> indexOfId;
+        map<string, int> indexOfName;
+        vector<int> points(6);
+        for (int position = 0; position < 6; position++) {
+            Team team = champ.getTeamAtPosition(position);
+            indexOfId[team.id] = position;
+            indexOfName[team.name] = position;
+            points[position] = team.getPoints();
+        }
+        vector<pair<int, int>> remaining;
+        for (int stage = played; stage < schedule.stageCount(); stage++) {
+            for (int slot = 0; slot < schedule.matchCount(stage); slot++) {
+                pair<int, int> ids = schedule.teamsAt(stage, slot);
+                remaining.push_back({indexOfId[ids.first], indexOfId[ids.second]});
+            }
+        }
+
+        SeasonOutlook outlook = champ.analyzeOutlook();
+        CHECK_EQ(outlook.remainingMatches, static_cast<int>(remaining.size()));
+        for (int i = 0; i < outlook.size(); i++) {
+            int team = indexOfName[outlook.teamNames[i]];
+            bool possible = titlePossibleByEnumeration(team, points, remaining);
+            // The flow model may keep a race open that no real result allows,
+            // but must never rule out a team that can still win
+            if (outlook.title[i] == SeasonOutlook::ELIMINATED) CHECK(!possible);
+            if (outlook.title[i] == SeasonOutlook::CLINCHED) {
+                for (int j = 0; j < 6; j++) {
+                    if (j != team) CHECK(!titlePossibleByEnumeration(j, points, remaining));
+                }
+            }
+        }
+    }
+}
+
+TEST(outlookSettlesEveryRaceAtTheEnd) {
+    QuietOutput quiet;
+    Championship champ = makeLeague("Done", 8, 2);
+    champ.generateFixtures();
+    for (int stage = 0; stage < champ.getTotalStages(); stage++) champ.playStage(stage, false);
+    SeasonOutlook outlook = champ.analyzeOutlook(2);
+    CHECK_EQ(outlook.remainingMatches, 0);
+    CHECK_EQ(outlook.title[0], SeasonOutlook::CLINCHED);
+    int relegated = 0;
+    for (int i = 1; i < outlook.size(); i++) CHECK_EQ(outlook.title[i], SeasonOutlook::ELIMINATED);
+    for (int i = 0; i < outlook.size(); i++) relegated += outlook.safety[i] == SeasonOutlook::ELIMINATED;
+    CHECK(relegated <= 2);
+}
+
+// ===== Forks =====
+
+TEST(forksShareDataUntilEitherSideChangesIt) {
+    QuietOutput quiet;
+    Championship original = makeLeague("Original", 10, 14);
+    original.generateFixtures();
+    for (int stage = 0; stage < 5; stage++) original.playStage(stage, false);
+    string before = describe(original);
+
+    Championship fork = original.fork("What If");
+    CHECK_EQ(fork.getName(), "What If");
+    CHECK(fork.sharesTeamsWith(original));
+    for (int stage = 0; stage < 5; stage++) CHECK(fork.sharesStageWith(original, stage));
+    CHECK_EQ(fork.getUndoCount(), 0);
+
+    // Only the stage the fork plays is copied
+    fork.playStage(5, false);
+    CHECK(!fork.sharesStageWith(original, 5));
+    CHECK(fork.sharesStageWith(original, 4));
+    CHECK(fork.sharesTeamsWith(original));
+    CHECK_EQ(describe(original), before);
+
+    // The seed is kept, so the original plays the same stage the same way
+    original.playStage(5, false);
+    for (int position = 0; position < 10; position++) {
+        CHECK_EQ(fork.getTeamAtPosition(position).name, original.getTeamAtPosition(position).name);
+    }
+
+    // Changing the team list copies it on the changing side only
+    fork.promoteTeam(Team("Newcomer", 25.0));
+    CHECK(!fork.sharesTeamsWith(original));
+    CHECK_EQ(fork.getTeamCount(), 11);
+    CHECK_EQ(original.getTeamCount(), 10);
+    CHECK(fork.sharesStageWith(original, 0));
+    original.relegateTeam("Team 1");
+    CHECK(fork.findTeam("Team 1").has_value());
+}
+
+TEST(batchForksAreJournaled) {
+    buildSampleChampionships();
+    QuietOutput quiet;
+    CHECK(saveData("forked.txt"));
+    CHECK(runBatchCommand({"fork", "What If"}));
+    CHECK_EQ(championships.size(), 3u);
+    CHECK_EQ(currentChampionship->getName(), "What If");
+    CHECK(runBatchCommand({"play-stage", "6"}));
+    string expected = describeAll();
+    CHECK(saveData("forked.txt"));
+    championships.clear();
+    CHECK(loadData("forked.txt"));
+    CHECK_EQ(describeAll(), expected);
+}
+
+// ===== Matchdays =====
+
+TEST(concurrentMatchdayPlaysLikeOneChampionshipAtATime) {
+    QuietOutput quiet;
+    championships.clear();
+    vector<Championship> sequential;
+    for (int i = 0; i < 7; i++) {
+        Championship champ = makeLeague("League " + to_string(i), 4 + 3 * i, 100 + i);
+        champ.generateFixtures();
+        championships.emplace_back(champ);
+        sequential.push_back(champ);
+    }
+    championships.push_back(makeLeague("No fixtures", 5, 1));
+
+    for (int stage = 0; stage < 6; stage++) {
+        vector<MatchdayResult> results = runMatchday(stage, 4);
+        CHECK_EQ(results.size(), championships.size());
+        for (size_t i = 0; i < sequential.size(); i++) {
+            sequential[i].simulateStage(stage);
+            CHECK_EQ(describe(championships[i]), describe(sequential[i]));
+            CHECK_EQ(results[i].championship, sequential[i].getName());
+            CHECK(results[i].played);
+            CHECK_EQ(results[i].matches, sequential[i].getStageMatchesPlayed(stage));
+            CHECK_EQ(results[i].goals, sequential[i].getStageGoals(stage));
+            CHECK_EQ(results[i].leader, sequential[i].getTeamAtPosition(0).name);
+        }
+        CHECK(!results.back().played);
+    }
+    CHECK(!runMatchday(99, 4)[0].played);
+    championships.clear();
+    CHECK(runMatchday(0).empty());
+}
+
+// ===== Team IDs =====
+
+TEST(relegatedTeamsKeepTheirIdsAndFixtures) {
+    QuietOutput quiet;
+    championships.clear();
+    championships.push_back(makeLeague("Ids", 4, 9));
+    Championship& champ = championships[0];
+    champ.generateFixtures();
+    champ.playStage(0);
+    champ.relegateTeam("Team 2");
+    champ.promoteTeam(Team("Team 5", 30.0));
+    CHECK(!champ.promoteTeam(Team("Team 5", 30.0)));  // Already in the league
+    CHECK(!champ.promoteTeam(Team("TEAM 5", 30.0)));  // Names ignore case
+    champ.addTeam(Team("team 1", 30.0));
+    CHECK_EQ(champ.getTeamCount(), 4);
+    string fixtures = captureOutput([&] { champ.displayFixtures(0); });
+    CHECK(fixtures.find("Team 2") != string::npos);
+
+    // Names of relegated teams survive a save and load
+    string saved = describe(champ);
+    CHECK(saveData("ids.txt"));
+    CHECK(readFile("ids.txt").rfind("FCM ", 0) == 0);
+    CHECK(loadData("ids.txt"));
+    CHECK_EQ(championships[0].getTeamCount(), 4);
+    CHECK_EQ(captureOutput([&] { championships[0].displayFixtures(0); }), fixtures);
+    CHECK_EQ(describe(championships[0]), saved);
+    championships.clear();
+}
+
+TEST(unversionedFilesInternFixtureNames) {
+    QuietOutput quiet;
+    writeFile("v1.txt", "1\nOld\n2 1 2 5\nA,10,1,0,0,2,0\nB,20,0,0,1,0,2\n2\n1\nA,B,2,0,1\n1\nB,A,0,0,0\n");
+    CHECK(loadData("v1.txt"));
+    CHECK_EQ(championships.size(), 1u);
+    Championship& champ = championships[0];
+    CHECK_EQ(champ.getTeamCount(), 2);
+    CHECK(captureOutput([&] { champ.displayFixtures(0); }).find("A vs B : 2-0") != string::npos);
+    CHECK(captureOutput([&] { champ.displayFixtures(1); }).find("B vs A") != string::npos);
+    championships.clear();
+}
+
+// ===== Ranking =====
+
+TEST(packedKeysOrderLikePointsThenGoalDifferenceThenGoals) {
+    mt19937_64 rng(7);
+    for (int i = 0; i < 20000; i++) {
+        int p1 = rng() % 200, d1 = int(rng() % 121) - 60, g1 = rng() % 150;
+        int p2 = rng() % 200, d2 = int(rng() % 121) - 60, g2 = rng() % 150;
+        if (i % 3 == 0) p2 = p1;
+        if (i % 6 == 0) d2 = d1;
+        bool above = make_tuple(p1, d1, g1) > make_tuple(p2, d2, g2);
+        CHECK_EQ(TeamStatsBlock::packKey(p1, d1, g1) > TeamStatsBlock::packKey(p2, d2, g2), above);
+    }
+}
+
+// refreshAll (the AVX2 kernel when built with -mavx2) against refresh, one
+// team at a time, including values outside the key's field ranges
+TEST(refreshAllMatchesTheScalarRefresh) {
+    mt19937_64 rng(5);
+    for (size_t n : {size_t(0), size_t(7), size_t(8), size_t(61)}) {
+        TeamStatsBlock block, scalar;
+        for (size_t i = 0; i < n; i++) {
+            Team team;
+            bool extreme = i % 5 == 0;
+            team.wins = extreme ? int(rng() % 800000) : int(rng() % 40);
+            team.draws = rng() % 40;
+            team.losses = rng() % 40;
+            team.goalsFor = extreme ? int(rng() % 8000000) : int(rng() % 120);
+            team.goalsAgainst = extreme ? int(rng() % 8000000) : int(rng() % 120);
+            block.push(team);
+            scalar.push(team);
+        }
+        block.refreshAll();
+        for (size_t i = 0; i < n; i++) scalar.refresh(i);
+        CHECK(block.points == scalar.points);
+        CHECK(block.goalDifference == scalar.goalDifference);
+        CHECK(block.sortKey == scalar.sortKey);
+    }
+}
+
+TEST(radixRankMatchesStableSort) {
+    mt19937_64 rng(3);
+    for (size_t n : {size_t(1), size_t(17), size_t(3000), size_t(70000)}) {
+        vector<uint64_t> keys(n);
+        for (uint64_t& key : keys) {
+            key = TeamStatsBlock::packKey(rng() % 90, int(rng() % 41) - 20, rng() % 60);
+        }
+        vector<int> expected(n);
+        iota(expected.begin(), expected.end(), 0);
+        stable_sort(expected.begin(), expected.end(), [&](int a, int b) { return keys[a] > keys[b]; });
+        for (int threads : {1, 4}) {
+            vector<int> order;
+            radixRankByKey(keys, order, threads);
+            CHECK(order == expected);
+        }
+    }
+}
+
+// Whether every team's position matches a full sort of the league by points,
+// goal difference, goals for and then registration order
+bool positionsMatchFullSort(Championship& champ, const vector<string>& registered) {
+    vector<Team> sorted;
+    for (const string& name : registered) sorted.push_back(*champ.findTeam(name));
+    stable_sort(sorted.begin(), sorted.end(), [](const Team& a, const Team& b) {
+        return make_tuple(a.getPoints(), a.getGoalDifference(), a.goalsFor) >
+               make_tuple(b.getPoints(), b.getGoalDifference(), b.goalsFor);
+    });
+    for (size_t position = 0; position < sorted.size(); position++) {
+        if (champ.getTeamPosition(sorted[position].name) != static_cast<int>(position) + 1) return false;
+    }
+    return true;
+}
+
+TEST(rankingMatchesAFullSortAfterEveryChange) {
+    QuietOutput quiet;
+    Championship champ = makeLeague("Rank", 16, 12);
+    vector<string> registered;
+    for (int i = 0; i < 16; i++) registered.push_back("Team " + to_string(i + 1));
+    CHECK(positionsMatchFullSort(champ, registered));
+
+    champ.generateFixtures();
+    for (int stage = 0; stage < 12; stage++) {
+        champ.playStage(stage);
+        CHECK(positionsMatchFullSort(champ, registered));
+        if (stage % 4 == 3) {
+            champ.playStage(stage - 1);  // Replaying reverses the old results first
+            CHECK(positionsMatchFullSort(champ, registered));
+        }
+    }
+
+    champ.relegateTeam("Team 4");
+    registered.erase(registered.begin() + 3);
+    champ.promoteTeam(Team("Team 17", 50.0));
+    registered.push_back("Team 17");
+    CHECK(positionsMatchFullSort(champ, registered));
+    champ.playStage(12);
+    CHECK(positionsMatchFullSort(champ, registered));
+}
+
+TEST(largeLeaguesRankLikeSmallOnes) {
+    // Above RADIX_MIN_TEAMS the ranking is rebuilt with the radix sort
+    mt19937_64 rng(21);
+    vector<Team> teams;
+    vector<string> registered;
+    for (size_t i = 0; i < RADIX_MIN_TEAMS + 500; i++) {
+        Team team("Club " + to_string(i), 20.0);
+        team.wins = rng() % 20;
+        team.draws = rng() % 10;
+        team.goalsFor = rng() % 50;
+        team.goalsAgainst = rng() % 50;
+        teams.push_back(team);
+        registered.push_back(team.name);
+    }
+    Championship champ("Large");
+    champ.addTeams(teams);
+    CHECK(positionsMatchFullSort(champ, registered));
+
+    stringstream saved;
+    champ.saveToFile(saved);
+    Championship loaded;
+    loaded.loadFromFile(saved, DATA_FORMAT_VERSION);
+    CHECK(positionsMatchFullSort(loaded, registered));
+}
+
+// ===== Team search =====
+
+TEST(nameIndexFindsWholeNamesAndWordPrefixes) {
+    TeamNameIndex index;
+    index.build({{0, "Universitatea Craiova"}, {1, "FC CFR 1907 Cluj"}, {2, "Universitatea Cluj"},
+                 {3, "Farul Constanta"}});
+    CHECK_EQ(index.find("universitatea CRAIOVA"), 0);
+    CHECK_EQ(index.find("Universitatea"), -1);
+
+    vector<int> univ = index.findPrefix("UNIV", 10);
+    CHECK_EQ(univ.size(), 2u);
+    CHECK(count(univ.begin(), univ.end(), 0) == 1 && count(univ.begin(), univ.end(), 2) == 1);
+    CHECK((index.findPrefix("cfr", 10) == vector<int>{1}));
+    vector<int> cluj = index.findPrefix("clu", 10);
+    CHECK_EQ(cluj.size(), 2u);
+    CHECK_EQ(index.findPrefix("clu", 1).size(), 1u);
+    CHECK(index.findPrefix("", 10).empty());
+
+    index.remove(0, "Universitatea Craiova");
+    CHECK_EQ(index.find("Universitatea Craiova"), -1);
+    CHECK((index.findPrefix("univ", 10) == vector<int>{2}));
+    index.add(4, "Petrolul Ploiesti");
+    CHECK_EQ(index.find("petrolul ploiesti"), 4);
+}
+
+TEST(championshipSearchFollowsPromotionAndRelegation) {
+    QuietOutput quiet;
+    Championship champ = makeLeague("Search", 4, 1);
+    CHECK(champ.findTeam("team 3").has_value());
+    CHECK(champ.relegateTeam("Team 3"));
+    CHECK(!champ.findTeam("Team 3").has_value());
+    CHECK(champ.promoteTeam(Team("Rapid Bucuresti", 40.0)));
+    CHECK(champ.findTeam("RAPID BUCURESTI").has_value());
+    vector<Team> found = champ.searchTeams("buc");
+    CHECK_EQ(found.size(), 1u);
+
+    // Forks share the index until either side changes its teams
+    Championship fork = champ.fork("Fork");
+    CHECK(fork.relegateTeam("rapid bucuresti"));
+    CHECK(champ.findTeam("Rapid Bucuresti").has_value());
+    CHECK(!fork.findTeam("Rapid Bucuresti").has_value());
+    CHECK_EQ(champ.searchTeams("team").size(), 3u);
+
+    resetProgramState();
+    championships.push_back(move(champ));
+    currentChampionship = &championships[0];
+    string listed = captureOutput([] { CHECK(runBatchCommand({"find", "rap"})); });
+    CHECK(listed.find("Rapid Bucuresti") != string::npos);
+    CHECK(listed.find("Team 1") == string::npos);
+    resetProgramState();
+}
+
+// ===== Metric comparison =====
+
+// Kendall's tau-b by comparing every pair
+double kendallByPairs(const vector<double>& x, const vector<double>& y) {
+    double concordant = 0, discordant = 0, tiedX = 0, tiedY = 0;
+    for (size_t i = 0; i < x.size(); i++) {
+        for (size_t j = i + 1; j < x.size(); j++) {
+            double dx = x[i] - x[j], dy = y[i] - y[j];
+            if (dx == 0 && dy == 0) continue;
+            if (dx == 0) tiedX++;
+            else if (dy == 0) tiedY++;
+            else if ((dx > 0) == (dy > 0)) concordant++;
+            else discordant++;
+        }
+    }
+    double denominator = sqrt((concordant + discordant + tiedX) * (concordant + discordant + tiedY));
+    return denominator == 0 ? 0.0 : (concordant - discordant) / denominator;
+}
+
+// Pearson correlation of the average ranks
+double spearmanByDefinition(const vector<double>& x, const vector<double>& y) {
+    vector<double> rx = averageRanks(x), ry = averageRanks(y);
+    double mx = accumulate(rx.begin(), rx.end(), 0.0) / rx.size();
+    double my = accumulate(ry.begin(), ry.end(), 0.0) / ry.size();
+    double sxy = 0, sxx = 0, syy = 0;
+    for (size_t i = 0; i < rx.size(); i++) {
+        sxy += (rx[i] - mx) * (ry[i] - my);
+        sxx += (rx[i] - mx) * (rx[i] - mx);
+        syy += (ry[i] - my) * (ry[i] - my);
+    }
+    return sxx > 0 && syy > 0 ? sxy / sqrt(sxx * syy) : 0.0;
+}
+
+TEST(rankCorrelationsMatchTheirDefinitions) {
+    vector<double> up = {1, 2, 3, 4, 5}, down = {5, 4, 3, 2, 1};
+    CHECK(fabs(spearmanRho(up, up) - 1.0) < 1e-12);
+    CHECK(fabs(spearmanRho(up, down) + 1.0) < 1e-12);
+    CHECK(fabs(kendallTauB(up, up) - 1.0) < 1e-12);
+    CHECK(fabs(kendallTauB(up, down) + 1.0) < 1e-12);
+    CHECK_EQ(kendallTauB({1, 1, 1}, {1, 2, 3}), 0.0);
+
+    vector<double> ranks = averageRanks({10, 20, 20, 5});
+    CHECK((ranks == vector<double>{3, 1.5, 1.5, 4}));
+
+    mt19937_64 rng(11);
+    for (int trial = 0; trial < 50; trial++) {
+        size_t n = 2 + rng() % 60;
+        vector<double> x(n), y(n);
+        for (size_t i = 0; i < n; i++) {
+            x[i] = rng() % 8;
+            y[i] = rng() % 8;
+        }
+        CHECK(fabs(kendallTauB(x, y) - kendallByPairs(x, y)) < 1e-9);
+        CHECK(fabs(spearmanRho(x, y) - spearmanByDefinition(x, y)) < 1e-9);
+    }
+}
+
+TEST(batchCompareRejectsUnknownMetrics) {
+    buildSampleChampionships();
+    string report = captureOutput([] { CHECK(runBatchCommand({"compare", "points", "gd"})); });
+    CHECK(report.find("Pts Pos") != string::npos && report.find("GD Pos") != string::npos);
+    QuietOutput quiet;
+    CHECK(!runBatchCommand({"compare", "points", "goals"}));
+    resetProgramState();
+}
+
+// ===== Standings formats =====
+
+TEST(csvAndJsonEscapeTeamNames) {
+    Championship champ("Cup \"A\"");
+    champ.addTeam(Team("Plain FC", 50.0));
+    champ.addTeam(Team("Steaua \"FCSB\"", 40.0));
+    champ.addTeam(Team("Dinamo, Bucuresti", 30.0));
+    champ.addTeam(Team("Back\\slash", 20.0));
+    champ.addTeam(Team("Line\nBreak\tTab", 10.0));
+
+    string csv = champ.renderStandings(StandingsFormat::CSV);
+    CHECK(csv.find(",Plain FC,") != string::npos);
+    CHECK(csv.find(",\"Steaua \"\"FCSB\"\"\",") != string::npos);
+    CHECK(csv.find(",\"Dinamo, Bucuresti\",") != string::npos);
+    CHECK(csv.find(",Back\\slash,") != string::npos);
+    CHECK(csv.find(",\"Line\nBreak\tTab\",") != string::npos);
+
+    string json = champ.renderStandings(StandingsFormat::JSON);
+    CHECK(json.rfind("{\"championship\":\"Cup \\\"A\\\"\",", 0) == 0);
+    CHECK(json.find("\"team\":\"Steaua \\\"FCSB\\\"\"") != string::npos);
+    CHECK(json.find("\"team\":\"Dinamo, Bucuresti\"") != string::npos);
+    CHECK(json.find("\"team\":\"Back\\\\slash\"") != string::npos);
+    CHECK(json.find("\"team\":\"Line\\u000aBreak\\u0009Tab\"") != string::npos);
+    CHECK_EQ(count(json.begin(), json.end(), '\n'), 7);  // One row per line, no raw newlines in names
+
+    ostringstream table;
+    champ.displayStandings(table);
+    CHECK_EQ(table.str(), champ.renderStandings(StandingsFormat::TABLE));
+}
+
+TEST(batchRenderAndExportPickTheFormat) {
+    buildSampleChampionships();
+    Championship& champ = championships[0];
+    string json = captureOutput([] { CHECK(runBatchCommand({"render", "json"})); });
+    CHECK_EQ(json, champ.renderStandings(StandingsFormat::JSON));
+    QuietOutput quiet;
+    CHECK(!runBatchCommand({"render", "xml"}));
+    CHECK(runBatchCommand({"export", "standings.json"}));
+    CHECK(runBatchCommand({"export", "standings.csv"}));
+    CHECK(runBatchCommand({"export", "standings.txt"}));
+    CHECK_EQ(readFile("standings.json"), champ.renderStandings(StandingsFormat::JSON));
+    CHECK_EQ(readFile("standings.csv"), champ.renderStandings(StandingsFormat::CSV));
+    CHECK_EQ(readFile("standings.txt"), champ.renderStandings(StandingsFormat::TABLE));
+    resetProgramState();
+}
+
+// ===== Standings history =====
+
+TEST(positionAtStageMatchesTheStandingsAfterThatStage) {
+    QuietOutput quiet;
+    Championship champ = makeLeague("History", 10, 8);
+    champ.generateFixtures();
+    vector<vector<int>> positions, points;
+    for (int stage = 0; stage < 9; stage++) {
+        champ.playStage(stage, false);
+        positions.emplace_back();
+        points.emplace_back();
+        for (int t = 1; t <= 10; t++) {
+            string name = "Team " + to_string(t);
+            positions.back().push_back(champ.getTeamPosition(name));
+            points.back().push_back(champ.findTeam(name)->getPoints());
+        }
+    }
+    auto matchesRecords = [&](const Championship& league, int stages) {
+        bool same = league.getTeamPositionAt("Team 1", stages + 1) == -1;
+        for (int t = 1; t <= 10; t++) {
+            string name = "Team " + to_string(t);
+            vector<pair<int, int>> trajectory = league.getPointsTrajectory(name);
+            same = same && trajectory.size() == static_cast<size_t>(stages);
+            for (int stage = 1; stage <= stages; stage++) {
+                same = same && league.getTeamPositionAt(name, stage) == positions[stage - 1][t - 1] &&
+                       trajectory[stage - 1] == make_pair(stage, points[stage - 1][t - 1]);
+            }
+        }
+        return same;
+    };
+    CHECK(matchesRecords(champ, 9));
+    CHECK_EQ(champ.getTeamPositionAt("Team 1", 0), -1);
+    CHECK_EQ(champ.getTeamPositionAt("Nobody", 1), -1);
+
+    stringstream saved;
+    champ.saveToFile(saved);
+    Championship loaded;
+    loaded.loadFromFile(saved, DATA_FORMAT_VERSION);
+    CHECK(matchesRecords(loaded, 9));
+
+    // Undoing a stage drops its record; playing it again records it anew
+    CHECK(champ.undoStage());
+    CHECK(champ.undoStage());
+    CHECK(matchesRecords(champ, 7));
+    CHECK(champ.redoStage());
+    CHECK(champ.redoStage());
+    CHECK(matchesRecords(champ, 9));
+}
+
+TEST(batchPositionAtReadsTheHistory) {
+    buildSampleChampionships();
+    // Liga 1 relegated a team, which resets its history
+    CHECK_EQ(championships[0].getTeamPositionAt("Team 2", 5), -1);
+    currentChampionship = &championships[1];
+    int expected = championships[1].getTeamPositionAt("Team 2", 3);
+    string line = captureOutput([] { CHECK(runBatchCommand({"position-at", "Team 2", "3"})); });
+    CHECK_EQ(line, "Team 2 was in position #" + to_string(expected) + " after stage 3\n");
+    QuietOutput quiet;
+    CHECK(!runBatchCommand({"position-at", "Team 2", "4"}));
+    CHECK(!runBatchCommand({"position-at", "Team 2", "x"}));
+    CHECK(runBatchCommand({"history", "Team 2"}));
+    CHECK(runBatchCommand({"form", "3"}));
+    CHECK(!runBatchCommand({"form", "0"}));
+    resetProgramState();
+}
+
+// ===== Championship registry =====
+
+TEST(registryKeepsAddressesAndStaleHandlesResolveToNull) {
+    ChampionshipRegistry registry;
+    Championship& first = registry.emplace_back("First");
+    ChampionshipHandle firstHandle = registry.handleAt(0);
+    for (int i = 1; i < 100; i++) registry.push_back(Championship("League " + to_string(i)));
+    CHECK_EQ(&registry[0], &first);
+    CHECK_EQ(registry.get(firstHandle), &first);
+    CHECK_EQ(registry.indexOf(&registry[70]), 70);
+    CHECK((registry.handleOf(&registry[70]) == registry.handleAt(70)));
+    Championship outside("Outside");
+    CHECK_EQ(registry.indexOf(&outside), -1);
+
+    ChampionshipHandle lastHandle = registry.handleAt(99);
+    registry.clear();
+    CHECK(registry.get(firstHandle) == nullptr);
+    CHECK(registry.get(lastHandle) == nullptr);
+
+    // A reused slot does not revive handles to the championship that held it
+    registry.emplace_back("Again");
+    CHECK(registry.get(firstHandle) == nullptr);
+    CHECK(!(registry.handleAt(0) == firstHandle));
+    CHECK_EQ(registry.get(registry.handleAt(0))->getName(), "Again");
+}
+
+TEST(loadsLeaveNoDanglingSelection) {
+    buildSampleChampionships();
+    Championship* selected = currentChampionship;
+    championships.push_back(championships[1].fork("Fork"));
+    CHECK_EQ(static_cast<Championship*>(currentChampionship), selected);
+
+    QuietOutput quiet;
+    writeFile("future.txt", "FCM 99 1\n0\n");
+    CHECK(!loadData("future.txt"));
+    CHECK_EQ(currentChampionship.get(), selected);
+
+    // Loading replaces every championship, so the old selection goes stale
+    CHECK(saveData("replaced.txt"));
+    CHECK(loadData("replaced.txt"));
+    CHECK(currentChampionship.get() == nullptr);
+    CHECK(!runBatchCommand({"standings"}));
+    resetProgramState();
+}
+
+// ===== Season simulation =====
+
+TEST(simulationCountsEverySeasonOncePerTeamAndPosition) {
+    QuietOutput quiet;
+    Championship champ = makeLeague("Sim", 10, 6);
+    champ.generateFixtures();
+    champ.playStage(0);
+    SimulationResult one = champ.simulateSeasons(300, 1);
+    for (int threads : {1, 3}) {
+        SimulationResult result = champ.simulateSeasons(300, threads);
+        CHECK(result.positionCounts == one.positionCounts);
+        CHECK(result.averagePoints == one.averagePoints);
+        CHECK_EQ(result.seasons, 300);
+        CHECK_EQ(result.teamCount, 10);
+        for (int i = 0; i < 10; i++) {
+            long long asTeam = 0, atPosition = 0;
+            for (int j = 0; j < 10; j++) {
+                asTeam += result.positionCounts[i * 10 + j];
+                atPosition += result.positionCounts[j * 10 + i];
+            }
+            CHECK_EQ(asTeam, 300);
+            CHECK_EQ(atPosition, 300);
+            CHECK(fabs(result.rangeProbability(i, 0, 10) - 1.0) < 1e-9);
+        }
+    }
+    CHECK_EQ(champ.simulateSeasons(0).seasons, 0);
+    CHECK_EQ(makeLeague("One", 1, 1).simulateSeasons(10).seasons, 0);
+
+    Championship huge = makeLeague("Huge", SIMULATION_MAX_TEAMS + 1, 1);
+    CHECK_EQ(huge.simulateSeasons(1).seasons, 0);
+}
+
+TEST(headToHeadSimulationDoesNotDependOnThreadCount) {
+    QuietOutput quiet;
+    Championship champ = makeLeague("H2H", 8, 4);
+    TieBreakRules rules;
+    rules.parse("h2h-points,h2h-goals,gd,gf");
+    champ.setTieBreaks(rules);
+    champ.generateFixtures();
+    for (int stage = 0; stage < 3; stage++) champ.playStage(stage, false);
+
+    // Workers reuse their matrix across seasons, so a season's results must be
+    // fully removed again or the tie-breaks drift with the split of seasons
+    SimulationResult one = champ.simulateSeasons(200, 1);
+    for (int threads : {2, 5}) {
+        SimulationResult result = champ.simulateSeasons(200, threads);
+        CHECK(result.positionCounts == one.positionCounts);
+        CHECK(result.averagePoints == one.averagePoints);
+    }
+}
+
+TEST(simulationKeepsPlayedResults) {
+    QuietOutput quiet;
+    Championship champ = makeLeague("Done", 6, 3);
+    champ.generateFixtures();
+    for (int stage = 0; stage < 10; stage++) champ.playStage(stage);
+
+    // Nothing is left to simulate, so every season ends like the real one
+    SimulationResult result = champ.simulateSeasons(50, 2);
+    for (int team = 0; team < 6; team++) {
+        int finished = -1;
+        for (int position = 0; position < 6; position++) {
+            if (result.probability(team, position) == 1.0) finished = position;
+        }
+        CHECK(finished >= 0);
+    }
+}
+
+// ===== Data files =====
+
+// Rewrite a version 6 data file as version 5 (no stage play counts) or 4
+// (no index table)
+string downgradeDataFile(const string& text, int version) {
+    istringstream in(text);
+    string header;
+    getline(in, header);
+    istringstream(header).ignore(4) >> header;
+    uint64_t generation = 0;
+    istringstream(text.substr(6, text.find('\n') - 6)) >> generation;
+    size_t count;
+    in >> count;
+    in.ignore();
+    vector<string> names;
+    vector<int> teamCounts;
+    vector<uint64_t> sizes;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t offset, size;
+        int teamCount;
+        string name;
+        in >> offset >> size >> teamCount;
+        in.ignore();
+        getline(in, name);
+        names.push_back(name);
+        teamCounts.push_back(teamCount);
+        sizes.push_back(size);
+    }
+    string body(istreambuf_iterator<char>(in), {});
+    vector<string> blocks;
+    size_t offset = 0;
+    for (uint64_t size : sizes) {
+        string block = body.substr(offset, size);
+        offset += size;
+        block.erase(block.rfind('\n', block.size() - 2) + 1);  // The stage play counts
+        blocks.push_back(block);
+    }
+
+    ostringstream out;
+    out << "FCM " << version << ' ' << generation << '\n' << count << '\n';
+    if (version >= 5) {
+        uint64_t position = 0;
+        for (size_t i = 0; i < count; i++) {
+            out << position << ' ' << blocks[i].size() << ' ' << teamCounts[i] << ' ' << names[i] << '\n';
+            position += blocks[i].size();
+        }
+    }
+    for (const string& block : blocks) out << block;
+    return out.str();
+}
+
+TEST(dataFileRoundTripsEveryChampionship) {
+    buildSampleChampionships();
+    string expected = describeAll();
+    {
+        QuietOutput quiet;
+        CHECK(saveData("round.txt"));
+        championships.clear();
+        CHECK(loadData("round.txt"));
+    }
+    CHECK_EQ(championships.size(), 2u);
+    CHECK(!championships.isParsed(0) && !championships.isParsed(1));
+    CHECK_EQ(championships.nameAt(1), "Liga 2");
+    CHECK_EQ(championships.teamCountAt(1), 7);
+    CHECK_EQ(championships.teamCountAt(0), 7);
+    CHECK_EQ(describe(championships[1]), expected.substr(expected.find("Liga 2|")));
+    CHECK(!championships.isParsed(0));
+    CHECK_EQ(describeAll(), expected);
+
+    // A full save of lazily loaded championships copies their blocks
+    {
+        QuietOutput quiet;
+        journal.detach();
+        CHECK(saveData("copy.txt"));
+        CHECK(loadData("copy.txt"));
+        CHECK(saveData("again.txt"));
+    }
+    CHECK_EQ(readFile("again.txt").substr(readFile("again.txt").find('\n')),
+             readFile("copy.txt").substr(readFile("copy.txt").find('\n')));
+    CHECK_EQ(describeAll(), expected);
+    resetProgramState();
+}
+
+TEST(olderDataFileVersionsStillLoad) {
+    buildSampleChampionships();
+    string withoutPlays = describeAll(false), withPlays = describeAll();
+    {
+        QuietOutput quiet;
+        CHECK(saveData("current.txt"));
+    }
+    string current = readFile("current.txt");
+    for (int version : {5, 4}) {
+        writeFile("older.txt", downgradeDataFile(current, version));
+        resetProgramState();
+        {
+            QuietOutput quiet;
+            CHECK(loadData("older.txt"));
+        }
+        CHECK_EQ(championships.isParsed(0), version == 4);
+        CHECK_EQ(describeAll(false), withoutPlays);
+    }
+
+    // Files whose line endings were converted to CRLF, including indexed ones
+    for (int version : {6, 5, 4}) {
+        string crlf;
+        for (char c : version == 6 ? current : downgradeDataFile(current, version)) {
+            if (c == '\n') crlf += '\r';
+            crlf += c;
+        }
+        writeFile("crlf.txt", crlf);
+        resetProgramState();
+        {
+            QuietOutput quiet;
+            CHECK(loadData("crlf.txt"));
+        }
+        CHECK_EQ(championships.nameAt(1), "Liga 2");
+        CHECK_EQ(describeAll(version == 6), version == 6 ? withPlays : withoutPlays);
+    }
+    resetProgramState();
+}
+
+TEST(damagedDataFilesAreRejectedWithoutLosingLoadedData) {
+    buildSampleChampionships();
+    {
+        QuietOutput quiet;
+        CHECK(saveData("good.txt"));
+    }
+    string good = readFile("good.txt");
+    string loaded = describeAll();
+
+    vector<string> damaged = {"", "garbage\n", "FCM x\n", "FCM 6 1\n-4\n", "FCM 6 1\n99999999\n",
+                              "FCM 99 1\n0\n", "FCM 6 1\n1\n0 100000 3 Far\n",
+                              downgradeDataFile(good, 4).substr(0, 60)};
+    for (const string& contents : damaged) {
+        writeFile("bad.txt", contents);
+        QuietOutput quiet;
+        CHECK(!loadData("bad.txt"));
+    }
+    CHECK_EQ(describeAll(), loaded);
+
+    // A line added inside a block moves every later block off its offset
+    string shifted = good;
+    shifted.insert(shifted.find("\nLiga 1\n", shifted.find("Liga 2")) + 8, "extra line\n");
+    writeFile("bad.txt", shifted);
+    {
+        QuietOutput quiet;
+        CHECK(!loadData("bad.txt"));
+    }
+    CHECK_EQ(describeAll(), loaded);
+
+    // Truncated copies either fail to load or load without crashing or hanging
+    for (size_t length = 0; length < good.size(); length += 1 + good.size() / 97) {
+        writeFile("cut.txt", good.substr(0, length));
+        QuietOutput quiet;
+        if (loadData("cut.txt")) {
+            for (size_t i = 0; i < championships.size(); i++) championships[i].getTeamCount();
+        }
+    }
+    resetProgramState();
+}
+
+TEST(outOfRangeTeamIdsAndScoresDamageTheFile) {
+    buildSampleChampionships();
+    {
+        QuietOutput quiet;
+        CHECK(saveData("good.txt"));
+    }
+    string loaded = describeAll();
+    string good = downgradeDataFile(readFile("good.txt"), 4);
+    auto patched = [&](const string& from, const string& to) {
+        string text = good;
+        size_t at = text.find(from);
+        CHECK(at != string::npos);
+        return text.replace(at, from.size(), to);
+    };
+
+    // Liga 1 keeps 7 teams and Team 8 as its only retired name (IDs 0-7);
+    // its first stored result follows the roster line and the match count
+    size_t result = good.find('\n', good.find("\n0,1,2,3,4,5,6,7\n") + 1);
+    result = good.find('\n', result + 1) + 1;
+    string firstResult = good.substr(result, good.find(',', result) - result);
+    vector<string> damaged = {
+        patched("\n0,Team 1,", "\n-1,Team 1,"),
+        patched("\n0,Team 1,", "\n8,Team 1,"),
+        patched("\n0,Team 1,", "\n2000000000,Team 1,"),
+        patched("\n7,Team 8\n", "\n8,Team 8\n"),
+        good.substr(0, result) + "300" + good.substr(result + firstResult.size()),
+        good.substr(0, result) + "-1" + good.substr(result + firstResult.size()),
+    };
+    for (const string& contents : damaged) {
+        writeFile("bad.txt", contents);
+        QuietOutput quiet;
+        CHECK(!loadData("bad.txt"));
+    }
+    CHECK_EQ(describeAll(), loaded);
+
+    // The same result in a journal record ends the replay
+    QuietOutput quiet;
+    CHECK(saveData("good.txt"));
+    string journalFile = readFile("good.txt.journal");
+    writeFile("good.txt.journal", journalFile + "S 0 6 300-1 0-0 1-1 2-2\n");
+    championships.clear();
+    CHECK(loadData("good.txt"));
+    CHECK_EQ(describeAll(), loaded);
+    resetProgramState();
+}
+
+TEST(damagedLazyBlockIsKeptByFullSaves) {
+    buildSampleChampionships();
+    {
+        QuietOutput quiet;
+        CHECK(saveData("lazy.txt"));
+    }
+    // Replace the first team line of Liga 1 with junk of the same length
+    string text = readFile("lazy.txt");
+    size_t line = text.find("\nLiga 1\n", text.find("Liga 2"));
+    line = text.find('\n', text.find('\n', line + 1) + 1) + 1;
+    size_t end = text.find('\n', line);
+    text.replace(line, end - line, string(end - line, 'x'));
+    writeFile("lazy.txt", text);
+
+    QuietOutput quiet;
+    CHECK(loadData("lazy.txt"));
+    CHECK_EQ(championships[0].getName(), "Liga 1");
+    CHECK_EQ(championships[0].getTeamCount(), 0);
+    CHECK_EQ(championships.teamCountAt(0), 7);
+    CHECK_EQ(championships[1].getTeamCount(), 7);
+
+    // A full save writes the damaged block back as it was
+    journal.detach();
+    CHECK(saveData("kept.txt"));
+    string kept = readFile("kept.txt");
+    CHECK_EQ(kept.substr(kept.find('\n')), text.substr(text.find('\n')));
+
+    // Once the championship is rebuilt, its new contents are saved instead
+    championships[0].addTeam(Team("Rebuilt", 50.0));
+    CHECK(saveData("rebuilt.txt"));
+    CHECK(loadData("rebuilt.txt"));
+    CHECK_EQ(championships[0].getTeamCount(), 1);
+    CHECK(championships[0].findTeam("Rebuilt").has_value());
+    CHECK_EQ(championships[1].getTeamCount(), 7);
+    resetProgramState();
+}
+
+TEST(batchCommandsOnlyParseTheChampionshipsTheyTouch) {
+    buildSampleChampionships();
+    {
+        QuietOutput quiet;
+        CHECK(saveData("touch.txt"));
+        resetProgramState();
+        CHECK(loadData("touch.txt"));
+        CHECK(runBatchCommand({"select", "Liga 2"}));
+        CHECK(runBatchCommand({"play-stage", "4"}));
+    }
+    CHECK(!championships.isParsed(0));
+    CHECK(championships.isParsed(1));
+    CHECK_EQ(championships[1].getStagesCompleted(), 4);
+    resetProgramState();
+}
+
+// ===== The journal =====
+
+TEST(journalReplaysChangesMadeSinceTheLastFullSave) {
+    buildSampleChampionships();
+    QuietOutput quiet;
+    CHECK(saveData("journaled.txt"));
+    string fullSave = readFile("journaled.txt");
+
+    CHECK(runBatchCommand({"select", "Liga 2"}));
+    CHECK(runBatchCommand({"play-stages", "4", "6"}));
+    CHECK(runBatchCommand({"play-stage", "5"}));
+    CHECK(runBatchCommand({"promote", "Rapid", "35"}));
+    CHECK(runBatchCommand({"relegate", "Team 2"}));
+    CHECK(runBatchCommand({"seed", "77"}));
+    CHECK(runBatchCommand({"tie-breaks", "gd,h2h-points"}));
+    CHECK(!runBatchCommand({"tie-breaks", "gd,bogus"}));
+    CHECK(runBatchCommand({"create", "Liga 3"}));
+    CHECK(runBatchCommand({"promote", "Otelul", "12"}));
+    CHECK(runBatchCommand({"promote", "Poli", "14"}));
+    CHECK(runBatchCommand({"generate-fixtures"}));
+    CHECK(runBatchCommand({"play-stage", "2"}));
+    CHECK(runBatchCommand({"select", "Liga 1"}));
+    CHECK(runBatchCommand({"reset"}));
+    string expected = describeAll();
+    CHECK(saveData("journaled.txt"));
+    CHECK_EQ(readFile("journaled.txt"), fullSave);  // Only the journal was written
+    CHECK(readFile("journaled.txt.journal").rfind("FCMJ ", 0) == 0);
+
+    championships.clear();
+    CHECK(loadData("journaled.txt"));
+    CHECK_EQ(describeAll(), expected);
+}
+
+TEST(unsavedChangesAreNotJournaled) {
+    buildSampleChampionships();
+    QuietOutput quiet;
+    CHECK(saveData("unsaved.txt"));
+    string expected = describeAll();
+    CHECK(runBatchCommand({"play-stage", "6"}));
+    CHECK(!filesystem::exists("unsaved.txt.journal"));
+
+    CHECK(loadData("unsaved.txt"));
+    CHECK_EQ(describeAll(), expected);
+}
+
+TEST(tornJournalRecordsAreIgnoredAndTrimmed) {
+    buildSampleChampionships();
+    QuietOutput quiet;
+    CHECK(saveData("torn.txt"));
+    CHECK(runBatchCommand({"select", "Liga 1"}));
+    CHECK(runBatchCommand({"play-stage", "6"}));
+    CHECK(saveData("torn.txt"));
+    string expected = describeAll();
+
+    // A crash in the middle of the next append leaves half a record
+    string journalFile = readFile("torn.txt.journal");
+    writeFile("torn.txt.journal", journalFile + "S 0 6 2-1 0-");
+    championships.clear();
+    CHECK(loadData("torn.txt"));
+    CHECK_EQ(describeAll(), expected);
+
+    // The next append replaces the torn record
+    CHECK(runBatchCommand({"select", "Liga 1"}));
+    CHECK(runBatchCommand({"play-stage", "7"}));
+    CHECK(saveData("torn.txt"));
+    expected = describeAll();
+    championships.clear();
+    CHECK(loadData("torn.txt"));
+    CHECK_EQ(describeAll(), expected);
+
+    // A journal from another generation is never replayed
+    string stale = readFile("torn.txt.journal");
+    CHECK(saveData("other.txt"));
+    writeFile("other.txt.journal", stale);
+    championships.clear();
+    CHECK(loadData("other.txt"));
+    CHECK_EQ(describeAll(), expected);
+}
+
+TEST(journalIsNotPairedWithFilesWithoutGeneration) {
+    buildSampleChampionships();
+    QuietOutput quiet;
+    CHECK(saveData("plain.txt"));
+    string text = readFile("plain.txt");
+    writeFile("plain.txt", "FCM 6" + text.substr(text.find('\n')));
+    writeFile("plain.txt.journal", "FCMJ 2 0\nX 0\n");
+    string expected = describeAll();
+    championships.clear();
+    CHECK(loadData("plain.txt"));
+    CHECK_EQ(describeAll(), expected);
+
+    // The first save is a full one under a new generation
+    CHECK(saveData("plain.txt"));
+    uint64_t generation = 0;
+    istringstream(readFile("plain.txt").substr(6)) >> generation;
+    CHECK(generation != 0);
+
+    // The stale journal is not replayed on top of the new file either
+    championships.clear();
+    CHECK(loadData("plain.txt"));
+    CHECK_EQ(describeAll(), expected);
+    resetProgramState();
+}
+
+// ===== Binary snapshots and archives =====
+
+// Flip bytes and truncate a file in many ways; load must fail or succeed
+// without crashing
+void corruptAndLoad(const string& good, const string& path, bool (*load)(const string&)) {
+    mt19937_64 rng(17);
+    for (int trial = 0; trial < 200; trial++) {
+        string damaged = good;
+        if (trial % 2) {
+            damaged.resize(rng() % damaged.size());
+        } else {
+            for (int flips = 0; flips < 3; flips++) damaged[rng() % damaged.size()] ^= 1 << (rng() % 8);
+        }
+        writeFile(path, damaged);
+        QuietOutput quiet;
+        if (load(path)) {
+            for (size_t i = 0; i < championships.size(); i++) championships[i].displayStandings();
+        }
+    }
+}
+
+TEST(snapshotRoundTripAndCorruptInput) {
+    buildSampleChampionships();
+    string expected = describeAll(false);
+    {
+        QuietOutput quiet;
+        CHECK(saveSnapshot("snapshot.bin"));
+        championships.clear();
+        CHECK(loadSnapshot("snapshot.bin"));
+    }
+    CHECK_EQ(championships.size(), 2u);
+    CHECK_EQ(describeAll(false), expected);
+
+    string good = readFile("snapshot.bin");
+    writeFile("bad.bin", "not a snapshot");
+    {
+        QuietOutput quiet;
+        CHECK(!loadSnapshot("bad.bin"));
+        writeFile("bad.bin", good.substr(0, good.size() - 8));
+        CHECK(!loadSnapshot("bad.bin"));
+    }
+    CHECK_EQ(describeAll(false), expected);
+    corruptAndLoad(good, "bad.bin", loadSnapshot);
+
+    // Fixtures that do not follow the circle method are stored match by match,
+    // and each match must name a known team
+    QuietOutput quiet;
+    writeFile("explicit.txt", "1\nOld\n2 1 1 5\nA,10,1,0,0,2,0\nB,20,0,0,1,0,2\n1\n1\nA,B,2,0,1\n");
+    CHECK(loadData("explicit.txt"));
+    CHECK(saveSnapshot("explicit.bin"));
+    string bin = readFile("explicit.bin");
+    SnapshotHeader header;
+    SnapshotChampionship record;
+    memcpy(&header, bin.data(), sizeof(header));
+    memcpy(&record, bin.data() + header.championshipsOffset, sizeof(record));
+    CHECK_EQ(record.rosterCount, 0u);
+    CHECK_EQ(record.matchCount, 1u);
+    CHECK(loadSnapshot("explicit.bin"));
+    for (int32_t badId : {2, -1}) {
+        for (size_t field : {offsetof(SnapshotMatch, homeId), offsetof(SnapshotMatch, awayId)}) {
+            string damaged = bin;
+            memcpy(&damaged[record.matchesOffset + field], &badId, sizeof(badId));
+            writeFile("bad.bin", damaged);
+            CHECK(!loadSnapshot("bad.bin"));
+        }
+    }
+    championships.clear();
+}
+
+TEST(archiveRoundTripAndCorruptInput) {
+    buildSampleChampionships();
+    string expected = describeAll(false);
+    {
+        QuietOutput quiet;
+        CHECK(saveData("archived.txt"));
+        CHECK(saveArchive("archive.fca"));
+        championships.clear();
+        CHECK(loadArchive("archive.fca"));
+    }
+    CHECK_EQ(describeAll(false), expected);
+
+    string good = readFile("archive.fca");
+    CHECK(good.size() < readFile("archived.txt").size());
+    writeFile("bad.fca", good.substr(0, good.size() / 2));
+    {
+        QuietOutput quiet;
+        CHECK(!loadArchive("bad.fca"));
+        CHECK(!runBatchCommand({"load-archive", "bad.fca"}));
+        CHECK(runBatchCommand({"load-archive", "archive.fca"}));
+    }
+    CHECK_EQ(describeAll(false), expected);
+    corruptAndLoad(good, "bad.fca", loadArchive);
+    resetProgramState();
+}
+
+// ===== Batch mode =====
+
+// Run the program's main() with the given arguments
+int runProgram(vector<string> args) {
+    args.insert(args.begin(), "football_manager");
+    vector<char*> argv;
+    for (string& arg : args) argv.push_back(&arg[0]);
+    return football_manager_main(argv.size(), argv.data());
+}
+
+TEST(batchCommandsRunWithoutPrompts) {
+    championships.clear();
+    currentChampionship = nullptr;
+    QuietOutput quiet;
+    CHECK(runBatchCommand({"create", "Batch"}));
+    for (int i = 1; i <= 5; i++) CHECK(runBatchCommand({"promote", "Club " + to_string(i), to_string(10 * i)}));
+    CHECK(!runBatchCommand({"promote", "club 1", "10"}));
+    CHECK(!runBatchCommand({"promote", "Club 6", "-3"}));
+    CHECK(runBatchCommand({"seed", "7"}));
+    CHECK(!runBatchCommand({"play-stage", "1"}));
+    CHECK(runBatchCommand({"generate-fixtures"}));
+    CHECK(runBatchCommand({"play-stages", "1", "3"}));
+    CHECK(!runBatchCommand({"play-stage", "11"}));
+    CHECK_EQ(championships[0].getStagesCompleted(), 3);
+    CHECK(runBatchCommand({"play-season"}));
+    CHECK_EQ(championships[0].getStagesCompleted(), 10);
+    CHECK(runBatchCommand({"relegate", "Club 5"}));
+    CHECK(!runBatchCommand({"relegate", "Club 5"}));
+    CHECK(!runBatchCommand({"bogus"}));
+    CHECK(!runBatchCommand({"seed"}));
+    CHECK(runBatchCommand({"save", "batch.txt"}));
+    CHECK(!runBatchCommand({"select", "Nope"}));
+    CHECK(runBatchCommand({"select", "1"}));
+
+    string position;
+    {
+        ostringstream captured;
+        streambuf* out = cout.rdbuf(captured.rdbuf());
+        CHECK(runBatchCommand({"position", "Club 1"}));
+        cout.rdbuf(out);
+        position = captured.str();
+    }
+    CHECK(position.rfind("Club 1 is in position #", 0) == 0);
+    championships.clear();
+}
+
+TEST(batchScriptsStopAtTheFirstFailure) {
+    championships.clear();
+    currentChampionship = nullptr;
+    CHECK((splitScriptLine("select \"Liga 1\" # comment") == vector<string>{"select", "Liga 1"}));
+    CHECK((splitScriptLine("promote \"\" 5") == vector<string>{"promote", "", "5"}));
+    CHECK(splitScriptLine("   # only a comment").empty());
+
+    QuietOutput quiet;
+    writeFile("good.script", "create League\n\npromote A 10\npromote B 20\ngenerate-fixtures\nplay-season\n");
+    CHECK(runBatchScript("good.script"));
+    CHECK_EQ(championships[0].getStagesCompleted(), 2);
+
+    writeFile("bad.script", "create Second\nplay-stage 1\npromote C 30\n");
+    CHECK(!runBatchScript("bad.script"));
+    CHECK_EQ(championships.size(), 2u);
+    CHECK_EQ(championships[1].getTeamCount(), 0);
+    CHECK(!runBatchScript("missing.script"));
+
+    CHECK_EQ(runProgram({"-f", "good.script", "save", "script.txt"}), 0);
+    CHECK_EQ(runProgram({"-f", "bad.script"}), 1);
+    CHECK_EQ(runProgram({"--bogus"}), 1);
+    CHECK_EQ(runProgram({"--help"}), 0);
+    CHECK_EQ(runProgram({"play-stage"}), 1);
+    championships.clear();
+    currentChampionship = nullptr;
+}
+
+TEST(batchNumbersMustBePlainIntegers) {
+    int value = 0;
+    CHECK(parseBatchInt("42", value) && value == 42);
+    CHECK(parseBatchInt("-7", value) && value == -7);
+    CHECK(!parseBatchInt("42a", value));
+    CHECK(!parseBatchInt("", value));
+    CHECK(!parseBatchInt("99999999999", value));
+}
+
+TEST(seedsMustBePlainNumbers) {
+    uint64_t seed = 0;
+    CHECK(parseBatchSeed("18446744073709551615", seed));
+    CHECK_EQ(seed, UINT64_MAX);
+    for (const char* text : {"", "-1", "12x", " 5", "18446744073709551616", "abc"}) {
+        CHECK(!parseBatchSeed(text, seed));
+    }
+
+    buildSampleChampionships();
+    QuietOutput quiet;
+    CHECK(!runBatchCommand({"seed", "-3"}));
+    CHECK_EQ(championships[0].getSeed(), 11u);
+    CHECK_EQ(runProgram({"--seed", "12x"}), 1);
+    CHECK(!hasSeedOverride);
+    resetProgramState();
+}
+
+// ===== Benchmarks =====
+
+// Files in dir whose names start with prefix
+size_t countFiles(const filesystem::path& dir, const string& prefix) {
+    size_t found = 0;
+    for (const filesystem::directory_entry& entry : filesystem::directory_iterator(dir)) {
+        found += entry.path().filename().string().rfind(prefix, 0) == 0;
+    }
+    return found;
+}
+
+TEST(benchmarkReportsEveryOperation) {
+    size_t tempFiles = countFiles(filesystem::temp_directory_path(), "benchmark_standings");
+    ostringstream report;
+    runBenchmarks(16, report);
+    vector<string> cases = {"generateFixtures", "playStage", "fork", "analyzeOutlook", "displayStandings",
+                            "exportStandingsToCSV", "recomputeStandings", "recomputeStandings/h2h", "saveToFile",
+                            "loadFromFile", "findTeam", "searchTeams", "compareMetrics", "renderStandings/json",
+                            "saveArchive", "loadArchive", "publishSnapshot"};
+    for (const string& name : cases) CHECK(report.str().find(name) != string::npos);
+    // A header, a rule and one line per case for the 16-team league only
+    string text = report.str();
+    CHECK_EQ(count(text.begin(), text.end(), '\n'), static_cast<long>(cases.size()) + 2);
+    // The export benchmark writes to the temp directory and cleans up
+    CHECK_EQ(countFiles(".", "benchmark_standings"), 0u);
+    CHECK_EQ(countFiles(filesystem::temp_directory_path(), "benchmark_standings"), tempFiles);
+
+#ifndef FC_COUNT_ALLOCS
+    // Allocations are only counted in builds with -DFC_COUNT_ALLOCS
+    istringstream lines(text);
+    string line, name, allocs;
+    getline(lines, line);
+    getline(lines, line);
+    while (getline(lines, line)) {
+        double teams, nsPerOp;
+        istringstream(line) >> name >> teams >> nsPerOp >> allocs;
+        CHECK_EQ(allocs, "-");
+    }
+#endif
+
+    QuietOutput quiet;
+    CHECK(!runBatchCommand({"benchmark", "ten"}));
+}
+
+TEST(textSaveRoundTripsThroughAnyStream) {
+    Championship champ = makeLeague("Streams", 9, 31);
+    {
+        QuietOutput quiet;
+        champ.generateFixtures();
+        for (int stage = 0; stage < 7; stage++) champ.playStage(stage, false);
+    }
+    stringstream saved;
+    champ.saveToFile(saved);
+    Championship loaded;
+    loaded.loadFromFile(saved, DATA_FORMAT_VERSION);
+    CHECK_EQ(describe(loaded), describe(champ));
+    CHECK_EQ(loaded.getTeamPosition("Team 3"), champ.getTeamPosition("Team 3"));
+}
+
+// ===== Query server =====
+
+class ServerConnection {
+private:
+    int fd;
+
+public:
+    explicit ServerConnection(const string& path) : fd(socket(AF_UNIX, SOCK_STREAM, 0)) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    ~ServerConnection() {
+        if (fd >= 0) close(fd);
+    }
+
+    bool connected() const { return fd >= 0; }
+    void send(const string& text) { ::send(fd, text.data(), text.size(), 0); }
+    void finishSending() { shutdown(fd, SHUT_WR); }
+
+    // Everything the server sends until it closes the connection
+    string receiveAll() {
+        string all;
+        char buffer[4096];
+        ssize_t n;
+        while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) all.append(buffer, n);
+        return all;
+    }
+
+    // One reply: the payload of an OK reply, or the ERR line
+    string query(const string& line) {
+        send(line + "\n");
+        string head;
+        char c;
+        while (recv(fd, &c, 1, 0) == 1 && c != '\n') head += c;
+        if (head.rfind("OK ", 0) != 0) return head;
+        size_t bytes = stoul(head.substr(head.rfind(' ') + 1));
+        string body(bytes, '\0');
+        size_t got = 0;
+        while (got < bytes) {
+            ssize_t n = recv(fd, &body[got], bytes - got, 0);
+            if (n <= 0) break;
+            got += n;
+        }
+        return body;
+    }
+};
+
+TEST(queryServerAnswersFromPublishedSnapshots) {
+    buildSampleChampionships();
+    {
+        QuietOutput quiet;
+        CHECK(queryServer.start("test.sock"));
+    }
+    ServerConnection client("test.sock");
+    CHECK(client.connected());
+    CHECK_EQ(client.query("standings csv"), championships[0].renderStandings(StandingsFormat::CSV));
+    CHECK_EQ(client.query("bogus"), "ERR Unknown command: bogus");
+    CHECK_EQ(client.query("fixtures 99"), "ERR Stage out of range (1-14)");
+    CHECK(client.query("position \"Team 1\"").find("is in position #") != string::npos);
+    CHECK_EQ(client.query("use Nope"), "ERR Championship not found: Nope");
+    CHECK_EQ(client.query("use 2"), "Using Liga 2\n");
+    CHECK_EQ(client.query("standings json"), championships[1].renderStandings(StandingsFormat::JSON));
+    CHECK(client.query(string(SERVER_MAX_LINE + 10, 'a')).rfind("ERR Query too long", 0) == 0);
+
+    // Changes are visible once published
+    ServerConnection second("test.sock");
+    {
+        QuietOutput quiet;
+        CHECK(runBatchCommand({"select", "Liga 1"}));
+        CHECK(runBatchCommand({"play-stage", "6"}));
+    }
+    CHECK_EQ(second.query("standings csv"), championships[0].renderStandings(StandingsFormat::CSV));
+    resetProgramState();
+}
+
+TEST(queryServerSendsEveryReplyBeforeClosing) {
+    buildSampleChampionships();
+    {
+        QuietOutput quiet;
+        CHECK(queryServer.start("test.sock"));
+    }
+    ServerConnection client("test.sock");
+    string queries;
+    for (int i = 0; i < 300; i++) queries += "standings json\n";
+    client.send(queries + "championships\n");
+    client.finishSending();
+    string replies = client.receiveAll();
+    size_t oks = 0;
+    for (size_t at = 0; (at = replies.find("OK ", at)) != string::npos; at += 3) oks++;
+    CHECK(oks >= 301);
+    CHECK(replies.find("2. Liga 2") != string::npos);
+    resetProgramState();
+}
+
+TEST(queryServerParsesLazyChampionshipsOnDemand) {
+    buildSampleChampionships();
+    string expected = championships[1].renderStandings(StandingsFormat::CSV);
+    {
+        QuietOutput quiet;
+        CHECK(saveData("served.txt"));
+        championships.clear();
+        CHECK(loadData("served.txt"));
+        CHECK(queryServer.start("test.sock"));
+    }
+    // The server reads blocks through its own stream, which (like the
+    // writer's) still sees the loaded file after a save replaced it
+    writeFile("other.txt", "FCM 6 1\n0\n");
+    filesystem::rename("other.txt", "served.txt");
+    ServerConnection client("test.sock");
+    CHECK(client.query("championships").find("2. Liga 2 (7 teams, not loaded yet)") != string::npos);
+    CHECK_EQ(client.query("use \"Liga 2\""), "Using Liga 2\n");
+    CHECK_EQ(client.query("standings csv"), expected);
+    queryServer.publish();
+    CHECK(!championships.isParsed(0));
+    CHECK(!championships.isParsed(1));
+    CHECK_EQ(championships[1].renderStandings(StandingsFormat::CSV), expected);
+    CHECK_EQ(client.query("standings csv"), expected);
+    resetProgramState();
+}
+
+TEST(onlyMenuChoicesThatChangeDataPublish) {
+    for (int choice : {1, 2, 3, 4, 6, 7, 14, 15, 17, 19, 20, 21, 22, 23, 24, 26, 30}) {
+        CHECK(menuChoiceChangesData(choice));
+    }
+    // Displays, reports, saves and exports leave the published snapshot as it is
+    for (int choice : {0, 5, 8, 9, 10, 11, 12, 13, 16, 18, 25, 27, 28, 29, 31, -1}) {
+        CHECK(!menuChoiceChangesData(choice));
+    }
+}
+
+// ===== Main =====
+
+int main() {
+    // Tests write their files in a scratch directory
+    filesystem::path scratch = filesystem::temp_directory_path() /
+                               ("championship_tests_" + to_string(getpid()));
+    filesystem::create_directories(scratch);
+    filesystem::current_path(scratch);
+    signal(SIGPIPE, SIG_IGN);
+
+    int failed = 0;
+    for (const TestCase& test : testCases()) {
+        int before = checkFailures;
+        test.run();
+        bool passed = checkFailures == before;
+        failed += !passed;
+        printf("%s %s\n", passed ? "PASS" : "FAIL", test.name);
+    }
+    resetProgramState();
+
+    filesystem::current_path(filesystem::temp_directory_path());
+    filesystem::remove_all(scratch);
+    printf("%zu tests, %d failed\n", testCases().size(), failed);
+    return failed == 0 ? 0 : 1;
+}